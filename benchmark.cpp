@@ -0,0 +1,871 @@
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "callsign-matcher.h"
+#include "callsign-rate-limit.h"
+#include "crc_ppp.h"
+#include "dissect-cache.h"
+#include "dissect-packet.h"
+#include "filter.h"
+#include "hashing.h"
+#include "mpsc-queue.h"
+#include "net.h"
+#include "random.h"
+#include "reactor.h"
+#include "seen.h"
+#include "seen-shm.h"
+#include "snapshot.h"
+#include "str.h"
+#include "time.h"
+
+
+// "incoming" queue per producer + a work-list of producers; like the
+// tranceiver/work_queue_t combination that was used before the mpsc_queue
+typedef struct {
+	std::condition_variable incoming_cv;
+	std::mutex              incoming_lock;
+	std::queue<uint64_t>    incoming;
+} bench_producer_t;
+
+typedef struct {
+	std::condition_variable        work_cv;
+	std::mutex                     work_lock;
+	std::queue<bench_producer_t *> work_list;
+} bench_work_list_t;
+
+double bench_queue_two_hop(const int n_producers, const int n_per_producer)
+{
+	bench_work_list_t              w;
+	std::vector<bench_producer_t *> producers;
+
+	for(int i=0; i<n_producers; i++)
+		producers.push_back(new bench_producer_t());
+
+	uint64_t start_ts = get_us();
+
+	std::vector<std::thread *> threads;
+
+	for(int i=0; i<n_producers; i++) {
+		threads.push_back(new std::thread([&w, p = producers.at(i), n_per_producer] {
+			for(int j=0; j<n_per_producer; j++) {
+				{
+					std::unique_lock<std::mutex> lck(p->incoming_lock);
+
+					p->incoming.push(j);
+
+					p->incoming_cv.notify_all();
+				}
+
+				{
+					std::unique_lock<std::mutex> lck(w.work_lock);
+
+					w.work_list.push(p);
+
+					w.work_cv.notify_one();
+				}
+			}
+		}));
+	}
+
+	for(int n=0; n<n_producers * n_per_producer; n++) {
+		bench_producer_t *p { nullptr };
+
+		{
+			std::unique_lock<std::mutex> lck(w.work_lock);
+
+			while(w.work_list.empty())
+				w.work_cv.wait(lck);
+
+			p = w.work_list.front();
+			w.work_list.pop();
+		}
+
+		std::unique_lock<std::mutex> lck(p->incoming_lock);
+
+		while(p->incoming.empty())
+			p->incoming_cv.wait(lck);
+
+		p->incoming.pop();
+	}
+
+	uint64_t end_ts = get_us();
+
+	for(auto th : threads) {
+		th->join();
+
+		delete th;
+	}
+
+	for(auto p : producers)
+		delete p;
+
+	return n_producers * n_per_producer / ((end_ts - start_ts) / 1000000.0);
+}
+
+double bench_queue_mpsc(const int n_producers, const int n_per_producer)
+{
+	mpsc_queue<uint64_t> q(4096);
+
+	uint64_t start_ts = get_us();
+
+	std::vector<std::thread *> threads;
+
+	for(int i=0; i<n_producers; i++) {
+		threads.push_back(new std::thread([&q, n_per_producer] {
+			for(int j=0; j<n_per_producer; j++) {
+				while(q.push(j) == false)
+					std::this_thread::yield();
+			}
+		}));
+	}
+
+	for(int n=0; n<n_producers * n_per_producer;) {
+		if (q.pop(100).has_value())
+			n++;
+	}
+
+	uint64_t end_ts = get_us();
+
+	for(auto th : threads) {
+		th->join();
+
+		delete th;
+	}
+
+	return n_producers * n_per_producer / ((end_ts - start_ts) / 1000000.0);
+}
+
+void bench_queue()
+{
+	constexpr int n_producers    = 8;
+	constexpr int n_per_producer = 250000;
+
+	printf("queue, %d producers: two-hop (mutex) %.0f packets/s\n", n_producers, bench_queue_two_hop(n_producers, n_per_producer));
+	printf("queue, %d producers: mpsc_queue      %.0f packets/s\n", n_producers, bench_queue_mpsc   (n_producers, n_per_producer));
+}
+
+// something that looks like the bridge-map of the switchboard
+typedef std::map<int, std::vector<int> > bench_table_t;
+
+void bench_fill_table(bench_table_t *const t)
+{
+	for(int i=0; i<16; i++) {
+		for(int j=0; j<4; j++)
+			(*t)[i].push_back(i * j);
+	}
+}
+
+double bench_routing_table(const int n_threads, const bool use_snapshot)
+{
+	constexpr int n_lookups = 1000000;
+
+	std::mutex              lock;
+	bench_table_t           table_locked;
+	snapshot<bench_table_t> table_snapshot;
+
+	bench_fill_table(&table_locked);
+
+	table_snapshot.update([](bench_table_t *const work) { bench_fill_table(work); });
+
+	std::atomic_uint64_t total { 0 };
+
+	uint64_t start_ts = get_us();
+
+	std::vector<std::thread *> threads;
+
+	for(int i=0; i<n_threads; i++) {
+		threads.push_back(new std::thread([&, i] {
+			uint64_t sum = 0;
+
+			for(int j=0; j<n_lookups; j++) {
+				if (use_snapshot) {
+					const bench_table_t *t = table_snapshot.get();
+
+					for(auto v : t->find((i + j) & 15)->second)
+						sum += v;
+				}
+				else {
+					std::unique_lock<std::mutex> lck(lock);
+
+					for(auto v : table_locked.find((i + j) & 15)->second)
+						sum += v;
+				}
+			}
+
+			total += sum;
+		}));
+	}
+
+	for(auto th : threads) {
+		th->join();
+
+		delete th;
+	}
+
+	uint64_t end_ts = get_us();
+
+	return n_threads * n_lookups / ((end_ts - start_ts) / 1000000.0);
+}
+
+void bench_routing()
+{
+	for(int n_threads : { 1, 4, 16 }) {
+		printf("routing table, %2d thread(s): mutex    %.0f lookups/s\n", n_threads, bench_routing_table(n_threads, false));
+		printf("routing table, %2d thread(s): snapshot %.0f lookups/s\n", n_threads, bench_routing_table(n_threads, true ));
+	}
+}
+
+void bench_filter()
+{
+	const std::string pattern = "to!=\"IDENT\" || protocol!=\"AX.25\"";
+
+	std::string error;
+
+	filter_t f { true, pattern, compile_filter(pattern, &error) };
+
+	if (!f.program) {
+		printf("filter: %s\n", error.c_str());
+
+		return;
+	}
+
+	timeval tv { };
+
+	uint8_t data[] = { 'a', 'b', 'c' };
+
+	message m(tv, nullptr, 1, data, sizeof data);
+
+	packet_meta meta;
+
+	meta.set(mk_to,       db_record_gen("IDENT"));
+	meta.set(mk_protocol, db_record_gen("AX.25"));
+
+	m.set_meta(meta);
+
+	const int n = 5000000;
+
+	int n_true = 0;
+
+	uint64_t start_ts = get_us();
+
+	for(int i=0; i<n; i++)
+		n_true += execute_filter(f, m);
+
+	double took = (get_us() - start_ts) / 1000000.;
+
+	printf("filter: %.0f evaluations/s (%d matched)\n", n / took, n_true);
+}
+
+void bench_callsign()
+{
+	const int n_patterns = 300;
+
+	std::vector<regex_t>  res;
+	callsign_matcher      cm;
+
+	for(int i=0; i<n_patterns; i++) {
+		std::string pattern = myformat(i % 3 == 0 ? "^PD%dABC$" : (i % 3 == 1 ? "^PE%dXY(-[0-9]+)?$" : "^ON%d"), i);
+
+		regex_t re;
+		regcomp(&re, pattern.c_str(), REG_EXTENDED | REG_NOSUB);
+		res.push_back(re);
+
+		cm.add(pattern);
+	}
+
+	const std::string callsign = "PE298XY-7";
+
+	const int n = 100000;
+
+	int n_regexec = 0;
+
+	uint64_t start_ts = get_us();
+
+	for(int i=0; i<n; i++) {
+		for(auto & re : res)
+			n_regexec += regexec(&re, callsign.c_str(), 0, nullptr, 0) == 0;
+	}
+
+	double took_regexec = (get_us() - start_ts) / 1000000.;
+
+	int n_matcher = 0;
+
+	start_ts = get_us();
+
+	for(int i=0; i<n; i++) {
+		auto matches = cm.match(callsign);
+
+		for(int j=0; j<n_patterns; j++)
+			n_matcher += callsign_is_match(matches, j);
+	}
+
+	double took_matcher = (get_us() - start_ts) / 1000000.;
+
+	printf("callsign, %d patterns: regexec          %.0f lookups/s (%d matched)\n", n_patterns, n / took_regexec, n_regexec);
+	printf("callsign, %d patterns: callsign_matcher %.0f lookups/s (%d matched)\n", n_patterns, n / took_matcher, n_matcher);
+
+	for(auto & re : res)
+		regfree(&re);
+}
+
+void bench_seen()
+{
+	for(int n_hashes : { 10000, 100000, 1000000 }) {
+		seen_t pars { 1, 60., n_hashes };
+
+		seen s(pars);
+
+		std::vector<uint64_t> packets;
+
+		uint64_t next_packet = 1;
+
+		for(int i=0; i<n_hashes; i++)
+			packets.push_back(next_packet++);
+
+		// fill the table
+		for(auto & p : packets)
+			s.check(reinterpret_cast<const uint8_t *>(&p), sizeof p);
+
+		const int n = 2000000;
+
+		int n_ok = 0;
+
+		uint64_t start_ts = get_us();
+
+		for(int i=0; i<n; i++) {
+			// half of the packets were seen before
+			uint64_t p = i & 1 ? packets[(i * 7919ll) % n_hashes] : next_packet++;
+
+			n_ok += s.check(reinterpret_cast<const uint8_t *>(&p), sizeof p).first;
+		}
+
+		double took = (get_us() - start_ts) / 1000000.;
+
+		printf("seen, %7d hashes: %.0f checks/s (%d new)\n", n_hashes, n / took, n_ok);
+	}
+
+	// several receivers sharing one (global) filter
+	for(int n_threads : { 1, 2, 4, 8 }) {
+		seen_t pars { 1, 60., 100000 };
+
+		seen s(pars);
+
+		const int n = 1000000;
+
+		std::vector<std::thread *> threads;
+
+		uint64_t start_ts = get_us();
+
+		for(int t=0; t<n_threads; t++) {
+			threads.push_back(new std::thread([&s, t] {
+				for(uint64_t i=0; i<n; i++) {
+					uint64_t p = (uint64_t(t) << 32) | (i % 50000);
+
+					s.check(reinterpret_cast<const uint8_t *>(&p), sizeof p);
+				}
+			}));
+		}
+
+		for(auto & th : threads) {
+			th->join();
+
+			delete th;
+		}
+
+		double took = (get_us() - start_ts) / 1000000.;
+
+		printf("seen, %d threads: %.0f checks/s\n", n_threads, n * n_threads / took);
+	}
+
+	// another process stamped a slot (slightly) later than our "now":
+	// that must still count as recent, not as ~19 days old
+	{
+		const char name[] = "/ham-router-benchmark-seen";
+
+		shm_unlink(name);
+
+		seen_shm ss(name, 1, 60., 8);  // one set of 8
+
+		uint64_t now = get_us();
+
+		for(uint32_t hash=1; hash<=7; hash++)
+			ss.check(hash, now - 10000000);
+
+		ss.check(100, now + 100000);
+
+		bool ok = ss.check(200, now) /* evicts an old one */ && ss.check(100, now) == false;
+
+		printf("seen-shm, clock ahead in other process: %s\n", ok ? "ok" : "FAILED");
+
+		shm_unlink(name);
+	}
+}
+
+
+void bench_crc32()
+{
+	std::vector<uint8_t> data(1600 + 8);
+
+	for(auto & byte : data)
+		byte = rand();
+
+	// must be bit-exact with the original implementation
+	for(size_t len=0; len<=1600; len++) {
+		for(size_t offset=0; offset<8; offset++) {
+			if (calc_crc32(&data[offset], len) != calc_crc32_reference(&data[offset], len)) {
+				printf("crc32: %s differs from the reference for %zu bytes (offset %zu)\n", calc_crc32_kernel_name(), len, offset);
+
+				return;
+			}
+		}
+	}
+
+	for(size_t frame_size : { 16, 64, 128, 256, 512, 1600 }) {
+		const int n   = 20000000 / frame_size;
+
+		uint32_t  sum = 0;
+
+		uint64_t start_ts = get_us();
+
+		for(int i=0; i<n; i++)
+			sum += calc_crc32_reference(&data[i & 7], frame_size);
+
+		double took_reference = (get_us() - start_ts) / 1000000.;
+
+		start_ts = get_us();
+
+		for(int i=0; i<n; i++)
+			sum += calc_crc32(&data[i & 7], frame_size);
+
+		double took = (get_us() - start_ts) / 1000000.;
+
+		printf("crc32, %4zu bytes: reference %6.0f MB/s, %s %6.0f MB/s (%08x)\n", frame_size,
+				n * frame_size / took_reference / 1000000., calc_crc32_kernel_name(),
+				n * frame_size / took / 1000000., sum);
+	}
+}
+
+void bench_crc16()
+{
+	std::vector<uint8_t> data(1600 + 8 + 2);
+
+	for(auto & byte : data)
+		byte = rand();
+
+	// must be bit-exact with the rfc 1171 loop
+	for(int len=0; len<=1600; len++) {
+		for(int offset=0; offset<8; offset++) {
+			uint16_t crc = compute_crc(&data[offset], len);
+
+			if (crc != compute_crc_reference(&data[offset], len)) {
+				printf("crc16: differs from the reference for %d bytes (offset %d)\n", len, offset);
+
+				return;
+			}
+
+			std::vector<uint8_t> frame(&data[offset], &data[offset + len]);
+
+			frame.push_back(crc);
+			frame.push_back(crc >> 8);
+
+			if (ok_crc(frame.data(), frame.size()) == false) {
+				printf("crc16: ok_crc fails for %d bytes\n", len);
+
+				return;
+			}
+		}
+	}
+
+	for(int frame_size : { 16, 64, 128, 256, 512, 1600 }) {
+		const int n   = 20000000 / frame_size;
+
+		uint32_t  sum = 0;
+
+		uint64_t start_ts = get_us();
+
+		for(int i=0; i<n; i++)
+			sum += compute_crc_reference(&data[i & 7], frame_size);
+
+		double took_reference = (get_us() - start_ts) / 1000000.;
+
+		start_ts = get_us();
+
+		for(int i=0; i<n; i++)
+			sum += compute_crc(&data[i & 7], frame_size);
+
+		double took = (get_us() - start_ts) / 1000000.;
+
+		printf("crc16, %4d bytes: byte-wise %6.0f MB/s, slicing-by-8 %6.0f MB/s (%08x)\n", frame_size,
+				n * frame_size / took_reference / 1000000., n * frame_size / took / 1000000., sum);
+	}
+}
+
+void bench_callsign_rate_limit()
+{
+	for(int n_callsigns : { 100, 10000 }) {
+		callsign_rate_limit crl({ 10, 60., 4096, false });
+
+		std::vector<std::string> callsigns;
+
+		for(int i=0; i<n_callsigns; i++)
+			callsigns.push_back(myformat("PD%dABC-%d", i, i % 16));
+
+		const int n    = 2000000;
+
+		int       n_ok = 0;
+
+		uint64_t start_ts = get_us();
+
+		for(int i=0; i<n; i++)
+			n_ok += crl.check(callsigns[(i * 7919ll) % n_callsigns], nullptr, start_ts + i);
+
+		double took = (get_us() - start_ts) / 1000000.;
+
+		printf("callsign rate limit, %5d callsigns: %.0f checks/s (%d allowed)\n", n_callsigns, n / took, n_ok);
+	}
+}
+
+void bench_dissect_cache()
+{
+	// every frame arrives via 3 tranceivers
+	std::vector<buffer> frames;
+
+	for(int i=0; i<1000; i++) {
+		std::string frame = myformat("<\xff\x01PD%dFVH-7>APLG01,WIDE1-1:!52%02d.%02dN/004%02d.%02dE>test %d", i, i % 60, i % 100, i % 60, (i * 7) % 100, i);
+
+		for(int copy=0; copy<3; copy++)
+			frames.push_back(buffer(reinterpret_cast<const uint8_t *>(frame.c_str()), frame.size()));
+	}
+
+	const int n_rounds = 100;
+
+	size_t n_fields = 0;
+
+	uint64_t start_ts = get_us();
+
+	for(int round=0; round<n_rounds; round++) {
+		for(auto & b : frames) {
+			auto fields = dissect_packet(b.get_pointer(), b.get_size());
+
+			if (fields.has_value()) {
+				n_fields += !fields.value().first.empty();
+
+				delete fields.value().second;
+			}
+		}
+	}
+
+	double took_plain = (get_us() - start_ts) / 1000000.;
+
+	start_ts = get_us();
+
+	for(int round=0; round<n_rounds; round++) {
+		// a new cache per round: only the 2 copies of each frame hit
+		dissect_cache dc(4096, nullptr);
+
+		for(auto & b : frames)
+			n_fields += !dc.dissect(b, calc_digest(b.get_pointer(), b.get_size())).empty();
+	}
+
+	double took_cached = (get_us() - start_ts) / 1000000.;
+
+	size_t n = frames.size() * n_rounds;
+
+	printf("dissect: %.0f frames/s, with cache: %.0f frames/s (%zu)\n", n / took_plain, n / took_cached, n_fields);
+}
+
+void bench_random()
+{
+	for(int syscall=0; syscall<2; syscall++) {
+		const int n   = syscall ? 1000000 : 50000000;
+
+		uint64_t  sum = 0;
+
+		uint64_t start_ts = get_us();
+
+		for(int i=0; i<n; i++)
+			sum += syscall ? get_random_uint64_t_syscall() : get_random_uint64_t();
+
+		double took = (get_us() - start_ts) / 1000000.;
+
+		printf("message ids, %s: %.0f ids/s (%lx)\n", syscall ? "getrandom()" : "xoshiro256**", n / took, sum);
+	}
+}
+
+// bound to 127.0.0.1, a random port
+static int bench_udp_socket(sockaddr_in *const addr)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	int rcvbuf = 8 * 1024 * 1024;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+
+	addr->sin_family      = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr->sin_port        = 0;
+
+	socklen_t len = sizeof(*addr);
+
+	if (bind(fd, reinterpret_cast<sockaddr *>(addr), len) == -1 || getsockname(fd, reinterpret_cast<sockaddr *>(addr), &len) == -1) {
+		perror("bind");
+
+		exit(1);
+	}
+
+	return fd;
+}
+
+// a loopback AXUDP flood, received via epoll (recvfrom per datagram) and
+// via io_uring (multishot recvmsg); like the tranceiver, each datagram is
+// copied into a buffer of its own
+void bench_axudp_flood()
+{
+	const int n_datagrams = 200000;
+	uint8_t   frame[72]   { 0 };
+
+	for(size_t i=0; i<sizeof frame; i++)
+		frame[i] = i * 7;
+
+	for(int use_io_uring=0; use_io_uring<2; use_io_uring++) {
+		const char *name = use_io_uring ? "io_uring" : "epoll";
+
+		reactor     r(1, use_io_uring);
+
+		if (use_io_uring && r.get_io_uring() == nullptr) {
+			printf("axudp flood, %s: not available\n", name);
+
+			continue;
+		}
+
+		sockaddr_in rx_addr { };
+		int         rx_fd   = bench_udp_socket(&rx_addr);
+		int         tx_fd   = socket(AF_INET, SOCK_DGRAM, 0);
+
+		std::atomic_uint64_t n_received  { 0 };
+		std::atomic_uint64_t last_rx_ts  { 0 };
+
+		auto receive = [&](const uint8_t *const p, const size_t len) {
+			uint8_t *copy = reinterpret_cast<uint8_t *>(malloc(len));
+
+			memcpy(copy, p, len);
+
+			free(copy);
+
+			n_received++;
+
+			last_rx_ts = get_us();
+		};
+
+		r.add(rx_fd, [&] {
+				uint8_t buffer[1600];
+
+				for(int i=0; i<16; i++) {
+					sockaddr_in from { };
+					socklen_t   from_len = sizeof from;
+
+					ssize_t n = recvfrom(rx_fd, buffer, sizeof buffer, MSG_DONTWAIT, reinterpret_cast<sockaddr *>(&from), &from_len);
+
+					if (n <= 0)
+						break;
+
+					receive(buffer, n);
+				}
+
+				return true;
+			},
+			[&](const uint8_t *const p, const size_t len, const sockaddr *const from) {
+				receive(p, len);
+
+				return true;
+			});
+
+		uint64_t start_ts = get_us();
+
+		for(int i=0; i<n_datagrams; i++) {
+			while(sendto(tx_fd, frame, sizeof frame, 0, reinterpret_cast<sockaddr *>(&rx_addr), sizeof rx_addr) == -1)
+				std::this_thread::yield();  // ENOBUFS
+		}
+
+		// wait for the receiver to go quiet
+		for(;;) {
+			uint64_t before = n_received;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+			if (n_received == before)
+				break;
+		}
+
+		double took = (last_rx_ts - start_ts) / 1000000.;
+
+		printf("axudp flood, %s: %.0f datagrams/s (%lu of %d received)\n", name, n_received / took, uint64_t(n_received), n_datagrams);
+
+		// transmitting: 16 peers per frame, sendto() each or all in one
+		// io_uring submission
+		std::vector<io_uring_send_t> items(16, { tx_fd, frame, sizeof frame, reinterpret_cast<sockaddr *>(&rx_addr), sizeof rx_addr, false });
+
+		const int n_batches = n_datagrams / items.size();
+
+		start_ts = get_us();
+
+		for(int i=0; i<n_batches; i++) {
+			if (use_io_uring)
+				r.get_io_uring()->transmit(items);
+			else {
+				for(auto & item : items)
+					sendto(item.fd, item.p, item.len, 0, item.to, item.to_len);
+			}
+		}
+
+		took = (get_us() - start_ts) / 1000000.;
+
+		printf("axudp transmit, %s: %.0f datagrams/s\n", name, n_batches * items.size() / took);
+
+		r.remove(rx_fd);
+
+		close(tx_fd);
+		close(rx_fd);
+	}
+}
+
+// one frame to 20 peers: as transmit_udp() did it (per peer resolve,
+// socket, sendto, close) versus resolved once + one sendmmsg()
+void bench_axudp_fanout()
+{
+	const int   n_peers  = 20;
+	const int   n_frames = 2000;
+	uint8_t     frame[72] { 0 };
+
+	sockaddr_in rx_addr  { };
+	int         rx_fd    = bench_udp_socket(&rx_addr);
+	std::string dest     = myformat("localhost:%d", ntohs(rx_addr.sin_port));
+
+	std::atomic_bool stop { false };
+
+	// keep the receive buffer from filling up
+	std::thread drain([rx_fd, &stop] {
+			uint8_t buffer[1600];
+
+			while(!stop) {
+				if (recv(rx_fd, buffer, sizeof buffer, MSG_DONTWAIT) <= 0)
+					usleep(100);
+			}
+		});
+
+	uint64_t start_ts = get_us();
+
+	for(int i=0; i<n_frames; i++) {
+		for(int j=0; j<n_peers; j++) {
+			addrinfo  hints  { };
+			hints.ai_family   = AF_UNSPEC;
+			hints.ai_socktype = SOCK_DGRAM;
+
+			addrinfo *result = nullptr;
+
+			if (getaddrinfo("localhost", myformat("%d", ntohs(rx_addr.sin_port)).c_str(), &hints, &result) != 0)
+				continue;
+
+			int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+
+			sendto(fd, frame, sizeof frame, 0, result->ai_addr, result->ai_addrlen);
+
+			close(fd);
+
+			freeaddrinfo(result);
+		}
+	}
+
+	double took_old = (get_us() - start_ts) / 1000000.;
+
+	sockaddr_storage addr     { };
+	socklen_t        addr_len { 0 };
+
+	resolve_udp(dest, AF_UNSPEC, &addr, &addr_len);
+
+	int fd = socket(addr.ss_family, SOCK_DGRAM, 0);
+
+	iovec                iov { frame, sizeof frame };
+	std::vector<mmsghdr> msgs(n_peers);
+
+	for(auto & msg : msgs) {
+		msg.msg_hdr.msg_name    = &addr;
+		msg.msg_hdr.msg_namelen = addr_len;
+		msg.msg_hdr.msg_iov     = &iov;
+		msg.msg_hdr.msg_iovlen  = 1;
+	}
+
+	start_ts = get_us();
+
+	for(int i=0; i<n_frames * 10; i++)
+		sendmmsg(fd, msgs.data(), msgs.size(), 0);
+
+	double took_new = (get_us() - start_ts) / 1000000.;
+
+	stop = true;
+
+	drain.join();
+
+	close(fd);
+	close(rx_fd);
+
+	printf("axudp fan-out to %d peers: %.0f frames/s, resolved + sendmmsg: %.0f frames/s\n", n_peers, n_frames / took_old, n_frames * 10 / took_new);
+}
+
+int main(int argc, char *argv[])
+{
+	std::string which = argc >= 2 ? argv[1] : "all";
+
+	if (which == "all" || which == "queue")
+		bench_queue();
+
+	if (which == "all" || which == "routing")
+		bench_routing();
+
+	if (which == "all" || which == "filter")
+		bench_filter();
+
+	if (which == "all" || which == "callsign")
+		bench_callsign();
+
+	if (which == "all" || which == "seen")
+		bench_seen();
+
+	if (which == "all" || which == "crc32")
+		bench_crc32();
+
+	if (which == "all" || which == "crc16")
+		bench_crc16();
+
+	if (which == "all" || which == "callsign-rate")
+		bench_callsign_rate_limit();
+
+	if (which == "all" || which == "dissect")
+		bench_dissect_cache();
+
+	if (which == "all" || which == "random")
+		bench_random();
+
+	if (which == "all" || which == "axudp-flood")
+		bench_axudp_flood();
+
+	if (which == "all" || which == "axudp-fanout")
+		bench_axudp_fanout();
+
+	return 0;
+}
@@ -7,29 +7,63 @@
 #include "utils.h"
 
 
-buffer::buffer(const uint8_t *p, const int size) : p(reinterpret_cast<uint8_t *>(duplicate(p, size))), size(size)
+buffer::buffer(const uint8_t *p, const int size) : buffer(reinterpret_cast<uint8_t *>(duplicate(p, size)), size, true)
 {
 }
 
-buffer::buffer(const buffer & b) : p(reinterpret_cast<uint8_t *>(duplicate(b.get_pointer(), b.get_size()))), size(b.get_size())
+buffer::buffer(uint8_t *const p, const int size, const bool adopt) :
+	data(adopt ? p : reinterpret_cast<uint8_t *>(duplicate(p, size)), [](const uint8_t *p) { free(const_cast<uint8_t *>(p)); }),
+	p(data.get()),
+	size(size)
 {
 }
 
+buffer::buffer(const std::shared_ptr<const uint8_t> & data, const uint8_t *const p, const int size) :
+	data(data),
+	p(p),
+	size(size)
+{
+}
+
+buffer::buffer(const buffer & b) : data(b.data), p(b.p), size(b.size)
+{
+}
+
+buffer::buffer(buffer && b) noexcept : data(std::move(b.data)), p(b.p), size(b.size), o(b.o)
+{
+	b.p    = nullptr;
+	b.size = 0;
+	b.o    = 0;
+}
+
 buffer::buffer() : p(nullptr), size(0)
 {
 }
 
 buffer::~buffer()
 {
-	free(const_cast<uint8_t *>(p));
 }
 
 buffer & buffer::operator=(const buffer & in)
 {
-	free(const_cast<uint8_t *>(p));
+	data = in.data;
+	p    = in.p;
+	size = in.size;
+	o    = 0;
 
-	p    = reinterpret_cast<uint8_t *>(duplicate(in.get_pointer(), in.get_size()));
-	size = in.get_size();
+	return *this;
+}
+
+buffer & buffer::operator=(buffer && in) noexcept
+{
+	data = std::move(in.data);
+	p    = in.p;
+	size = in.size;
+	o    = in.o;
+
+	in.p    = nullptr;
+	in.size = 0;
+	in.o    = 0;
 
 	return *this;
 }
@@ -102,12 +136,20 @@ buffer buffer::get_segment(const int len)
 	if (o + len > size)
 		throw std::out_of_range("buffer::get_segment");
 
-	buffer temp = buffer(&p[o], len);
+	buffer temp = buffer(data, &p[o], len);
 	o += len;
 
 	return temp;
 }
 
+buffer buffer::get_slice(const int offset, const int len) const
+{
+	if (offset < 0 || len < 0 || offset + len > size)
+		throw std::out_of_range("buffer::get_slice");
+
+	return buffer(data, &p[offset], len);
+}
+
 std::string buffer::get_string(const int len)
 {
 	if (o + len > size)
@@ -1,23 +1,35 @@
 #pragma once
 
+#include <memory>
 #include <stdint.h>
 #include <string>
 
 
+// The contents are immutable and shared between copies (reference
+// counted); copying a buffer or taking a segment of it does not copy
+// the data. Only the read-offset is per instance.
 class buffer
 {
 private:
-	uint8_t *p    { nullptr };
-	int      size { 0       };
-	int      o    { 0       };
+	std::shared_ptr<const uint8_t> data;
+
+	const uint8_t *p    { nullptr };  // start of this slice within data
+	int            size { 0       };
+	int            o    { 0       };
+
+	buffer(const std::shared_ptr<const uint8_t> & data, const uint8_t *const p, const int size);
 
 public:
 	buffer(const uint8_t *p, const int size);
+	// takes ownership of p (must be allocated with malloc)
+	buffer(uint8_t *const p, const int size, const bool adopt);
 	buffer(const buffer & b);
+	buffer(buffer && b) noexcept;
 	buffer();
 	virtual ~buffer();
 
 	buffer    & operator=(const buffer &);
+	buffer    & operator=(buffer &&) noexcept;
 
 	uint8_t     get_byte();
 	uint16_t    get_net_short();  // 2 bytes
@@ -28,6 +40,7 @@ public:
 	const uint8_t * get_bytes(const int len);
 
 	buffer      get_segment(const int len);
+	buffer      get_slice(const int offset, const int len) const;
 
 	std::string get_string(const int len);
 	std::string get_string();
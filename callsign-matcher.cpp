@@ -0,0 +1,228 @@
+#include <ctype.h>
+
+#include "callsign-matcher.h"
+#include "error.h"
+#include "log.h"
+
+
+typedef enum { cpt_all, cpt_exact, cpt_any_ssid, cpt_prefix, cpt_substring, cpt_regex } callsign_pattern_type_t;
+
+static bool is_literal(const std::string & in)
+{
+	for(auto c : in) {
+		if (isalnum(static_cast<unsigned char>(c)) == false && c != '-' && c != '/')
+			return false;
+	}
+
+	return true;
+}
+
+static bool strip_suffix(std::string *const in, const std::string & what)
+{
+	if (in->size() < what.size() || in->compare(in->size() - what.size(), what.size(), what) != 0)
+		return false;
+
+	in->erase(in->size() - what.size());
+
+	return true;
+}
+
+// regexec() searches (it is not anchored), so "CALL" is a substring match
+static callsign_pattern_type_t analyze_pattern(const std::string & pattern, std::string *const literal)
+{
+	std::string work     = pattern;
+
+	bool        anchored = work.empty() == false && work[0] == '^';
+
+	if (anchored)
+		work.erase(0, 1);
+	else if (work.substr(0, 2) == ".*")
+		work.erase(0, 2);
+
+	callsign_pattern_type_t type = anchored ? cpt_prefix : cpt_substring;
+
+	if (strip_suffix(&work, "(-[0-9]+)?$")) {
+		if (anchored == false)
+			return cpt_regex;
+
+		type = cpt_any_ssid;
+	}
+	else if (strip_suffix(&work, "$")) {
+		if (anchored == false)
+			return cpt_regex;
+
+		type = cpt_exact;
+	}
+	else {
+		strip_suffix(&work, ".*");
+	}
+
+	if (is_literal(work) == false)
+		return cpt_regex;
+
+	*literal = work;
+
+	if (work.empty() && (type == cpt_prefix || type == cpt_substring))
+		return cpt_all;
+
+	return type;
+}
+
+callsign_matcher::callsign_matcher() :
+	root(new callsign_trie_node_t())
+{
+}
+
+callsign_matcher::~callsign_matcher()
+{
+	free_trie(root);
+
+	for(auto & r : regexes)
+		regfree(&r.re);
+}
+
+void callsign_matcher::free_trie(callsign_trie_node_t *const node)
+{
+	for(auto & child : node->children)
+		free_trie(child.second);
+
+	delete node;
+}
+
+bool callsign_matcher::is_valid(const std::string & pattern)
+{
+	regex_t re;
+
+	if (regcomp(&re, pattern.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+		return false;
+
+	regfree(&re);
+
+	return true;
+}
+
+void callsign_matcher::set_bit(callsign_matches_t *const m, const size_t nr)
+{
+	if (m->size() <= nr / 64)
+		m->resize(nr / 64 + 1);
+
+	(*m)[nr / 64] |= uint64_t(1) << (nr & 63);
+}
+
+void callsign_matcher::merge(const callsign_matches_t & in, callsign_matches_t *const out)
+{
+	for(size_t i=0; i<in.size(); i++)
+		(*out)[i] |= in[i];
+}
+
+size_t callsign_matcher::add(const std::string & pattern)
+{
+	size_t      nr = n_patterns++;
+
+	std::string literal;
+
+	auto        type = analyze_pattern(pattern, &literal);
+
+	if (type == cpt_all) {
+		set_bit(&match_all, nr);
+	}
+	else if (type == cpt_substring) {
+		substrings.push_back({ literal, nr });
+	}
+	else if (type == cpt_regex) {
+		callsign_regex_t r { };
+
+		if (regcomp(&r.re, pattern.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+			error_exit(false, "callsign_matcher: \"%s\" is not a valid regular expression", pattern.c_str());
+
+		r.nr = nr;
+
+		regexes.push_back(r);
+	}
+	else {
+		callsign_trie_node_t *node = root;
+
+		for(auto c : literal) {
+			auto it = node->children.find(c);
+
+			if (it == node->children.end())
+				it = node->children.insert({ c, new callsign_trie_node_t() }).first;
+
+			node = it->second;
+		}
+
+		if (type == cpt_exact)
+			set_bit(&node->exact, nr);
+		else if (type == cpt_any_ssid)
+			set_bit(&node->any_ssid, nr);
+		else
+			set_bit(&node->prefix, nr);
+	}
+
+	log(LL_DEBUG, "callsign_matcher: \"%s\" is a%s match", pattern.c_str(), type == cpt_regex ? " regular expression" : "n indexed");
+
+	return nr;
+}
+
+static bool is_ssid(const char *const p)
+{
+	if (p[0] != '-' || p[1] == 0x00)
+		return false;
+
+	for(size_t i=1; p[i]; i++) {
+		if (isdigit(static_cast<unsigned char>(p[i])) == false)
+			return false;
+	}
+
+	return true;
+}
+
+callsign_matches_t callsign_matcher::match(const std::string & callsign) const
+{
+	callsign_matches_t out((n_patterns + 63) / 64);
+
+	merge(match_all, &out);
+
+	// one walk through the trie for all exact/ssid/prefix patterns
+	const callsign_trie_node_t *node = root;
+	const char                 *p    = callsign.c_str();
+
+	for(;;) {
+		merge(node->prefix, &out);
+
+		if (*p == 0x00) {
+			merge(node->exact,    &out);
+			merge(node->any_ssid, &out);
+
+			break;
+		}
+
+		if (node->any_ssid.empty() == false && is_ssid(p))
+			merge(node->any_ssid, &out);
+
+		auto it = node->children.find(*p);
+
+		if (it == node->children.end())
+			break;
+
+		node = it->second;
+
+		p++;
+	}
+
+	for(auto & s : substrings) {
+		if (callsign.find(s.literal) != std::string::npos)
+			set_bit(&out, s.nr);
+	}
+
+	for(auto & r : regexes) {
+		int rc = regexec(&r.re, callsign.c_str(), 0, nullptr, 0);
+
+		if (rc == 0)
+			set_bit(&out, r.nr);
+		else if (rc != REG_NOMATCH)
+			log_regexp_error(rc, const_cast<regex_t *>(&r.re), "callsign_matcher::match");
+	}
+
+	return out;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <regex.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+// bit n is set when pattern n matched
+typedef std::vector<uint64_t> callsign_matches_t;
+
+typedef struct callsign_trie_node
+{
+	std::map<char, callsign_trie_node *> children;
+
+	callsign_matches_t exact;      // "^CALL$"
+	callsign_matches_t any_ssid;   // "^CALL(-[0-9]+)?$"
+	callsign_matches_t prefix;     // "^CALL" / "^CALL.*"
+} callsign_trie_node_t;
+
+typedef struct
+{
+	std::string literal;
+	size_t      nr;
+} callsign_substring_t;
+
+typedef struct
+{
+	regex_t     re;
+	size_t      nr;
+} callsign_regex_t;
+
+// Matches a callsign against many (POSIX extended) regular expressions
+// in one pass. Patterns that are plain literals (optionally anchored
+// and/or with an SSID wildcard) are put in a trie, everything else
+// falls back to regexec().
+class callsign_matcher
+{
+private:
+	size_t                            n_patterns { 0 };
+
+	callsign_trie_node_t             *root       { nullptr };
+	callsign_matches_t                match_all;
+	std::vector<callsign_substring_t> substrings;
+	std::vector<callsign_regex_t>     regexes;
+
+	static void set_bit  (callsign_matches_t *const m, const size_t nr);
+	static void merge    (const callsign_matches_t & in, callsign_matches_t *const out);
+	static void free_trie(callsign_trie_node_t *const node);
+
+public:
+	callsign_matcher();
+	callsign_matcher(const callsign_matcher &) = delete;
+	virtual ~callsign_matcher();
+
+	static bool is_valid(const std::string & pattern);
+
+	// returns the pattern number (assigned incrementally from 0)
+	size_t add(const std::string & pattern);
+
+	size_t get_n_patterns() const { return n_patterns; }
+
+	callsign_matches_t match(const std::string & callsign) const;
+};
+
+inline bool callsign_is_match(const callsign_matches_t & m, const size_t nr)
+{
+	return (m[nr / 64] >> (nr & 63)) & 1;
+}
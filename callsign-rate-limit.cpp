@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <functional>
+
+#include "callsign-rate-limit.h"
+#include "error.h"
+#include "time.h"
+
+
+static constexpr int      n_ways       { 4   };
+static constexpr uint64_t token_unit   { 256 };  // tokens are stored in 1/256th
+static constexpr uint64_t tokens_mask  { (1 << 24) - 1 };
+
+callsign_rate_limit::callsign_rate_limit(const callsign_rate_limit_t & pars) :
+	max_per_dt(pars.max_per_dt),
+	dt_us(uint64_t(pars.dt * 1000000)),
+	per_tranceiver(pars.per_tranceiver),
+	start_us(get_us())
+{
+	n_sets = 1;
+
+	while(n_sets * n_ways < size_t(pars.max_n_callsigns))
+		n_sets <<= 1;
+
+	buckets = new callsign_bucket_t[n_sets * n_ways];
+
+	for(size_t i=0; i<n_sets * n_ways; i++) {
+		buckets[i].key   = 0;
+		buckets[i].state = 0;
+	}
+}
+
+callsign_rate_limit::~callsign_rate_limit()
+{
+	delete [] buckets;
+}
+
+callsign_bucket_t * callsign_rate_limit::find_bucket(const uint64_t key, const uint64_t now_ms)
+{
+	callsign_bucket_t *set = &buckets[(key & (n_sets - 1)) * n_ways];
+
+	for(;;) {
+		callsign_bucket_t *victim     = nullptr;
+		uint64_t           victim_key = 0;
+		uint64_t           oldest     = UINT64_MAX;
+
+		for(int i=0; i<n_ways; i++) {
+			uint64_t cur_key = set[i].key.load(std::memory_order_acquire);
+
+			if (cur_key == key)
+				return &set[i];
+
+			uint64_t last_ms = set[i].state.load(std::memory_order_relaxed) >> 24;
+
+			if (cur_key == 0 || last_ms < oldest) {
+				victim     = &set[i];
+				victim_key = cur_key;
+				oldest     = cur_key == 0 ? 0 : last_ms;
+			}
+		}
+
+		// (re-)use the least recently used bucket; a new bucket is
+		// full. A thread that finds the key before the state is
+		// reset may briefly see the old state: good enough here.
+		if (victim->key.compare_exchange_strong(victim_key, key, std::memory_order_acq_rel)) {
+			victim->state.store(pack_state(now_ms, max_per_dt * token_unit), std::memory_order_release);
+
+			return victim;
+		}
+
+		// an other thread took it: look again
+	}
+}
+
+bool callsign_rate_limit::check(const std::string & callsign, const void *const source, const uint64_t now_us)
+{
+	uint64_t key = std::hash<std::string>{}(callsign);
+
+	if (per_tranceiver)
+		key = key * 31 + std::hash<const void *>{}(source);
+
+	if (key == 0)
+		key = 1;
+
+	uint64_t now_ms     = now_us > start_us ? (now_us - start_us) / 1000 : 0;
+
+	uint64_t max_tokens = max_per_dt * token_unit;
+
+	callsign_bucket_t *b = find_bucket(key, now_ms);
+
+	uint64_t state = b->state.load(std::memory_order_acquire);
+
+	for(;;) {
+		uint64_t last_ms  = state >> 24;
+		uint64_t tokens   = state & tokens_mask;
+		uint64_t new_last = last_ms;
+
+		if (now_ms > last_ms) {
+			uint64_t elapsed_us = (now_ms - last_ms) * 1000;
+
+			if (elapsed_us >= dt_us)
+				tokens = max_tokens;
+			else {
+				uint64_t add = elapsed_us * max_tokens / dt_us;
+
+				// only move the clock by the time that the added
+				// tokens represent, else frequent checks would
+				// never (or too slowly) refill the bucket
+				if (add) {
+					uint64_t used_ms = add * dt_us / max_tokens / 1000;
+
+					tokens  += add;
+
+					new_last = used_ms ? last_ms + used_ms : now_ms;
+				}
+			}
+		}
+
+		if (tokens >= max_tokens) {
+			tokens   = max_tokens;
+
+			new_last = std::max(now_ms, last_ms);
+		}
+
+		bool allow = tokens >= token_unit;
+
+		if (allow)
+			tokens -= token_unit;
+
+		uint64_t new_state = pack_state(new_last, tokens);
+
+		if (b->state.compare_exchange_weak(state, new_state, std::memory_order_acq_rel))
+			return allow;
+	}
+}
+
+bool callsign_rate_limit::check(const message & m)
+{
+	auto from = m.get_meta().find(mk_from);
+
+	if (from == nullptr)
+		return true;
+
+	return check(from->s_value, m.get_source(), get_us());
+}
+
+callsign_rate_limit *callsign_rate_limit::instantiate(const libconfig::Setting & node_in)
+{
+	callsign_rate_limit_t pars { 1, 1., 4096, false };
+
+        for(int i=0; i<node_in.getLength(); i++) {
+                const libconfig::Setting & node = node_in[i];
+
+		std::string type = node.getName();
+
+		if (type == "max-per-interval")
+			pars.max_per_dt      = node_in.lookup(type);
+		else if (type == "interval-duration")
+			pars.dt              = int(node_in.lookup(type));
+		else if (type == "max-n-elements")
+			pars.max_n_callsigns = node_in.lookup(type);
+		else if (type == "per-tranceiver")
+			pars.per_tranceiver  = node_in.lookup(type);
+		else
+			error_exit(false, "(line %d): setting \"%s\" is not known", node.getSourceLine(), type.c_str());
+        }
+
+	if (pars.max_per_dt < 1 || pars.max_per_dt >= 65536)
+		error_exit(false, "(line %d): max-per-interval must be between 1 and 65535", node_in.getSourceLine());
+
+	if (pars.dt <= 0)
+		error_exit(false, "(line %d): interval-duration must be 1 or more", node_in.getSourceLine());
+
+	return new callsign_rate_limit(pars);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <libconfig.h++>
+#include <stdint.h>
+#include <string>
+
+#include "message.h"
+
+
+typedef struct {
+	int    max_per_dt;
+	double dt;
+	int    max_n_callsigns;
+	bool   per_tranceiver;  // a bucket per callsign + receiving tranceiver
+} callsign_rate_limit_t;
+
+typedef struct {
+	std::atomic_uint64_t key;    // hash of the callsign, 0: not used
+	std::atomic_uint64_t state;  // see pack_state()
+} callsign_bucket_t;
+
+// Token bucket per source callsign (a station sending a slightly
+// different beacon every second is not a duplicate, but is still too
+// much). Fixed-size, 4-way set-associative table: when a set is full,
+// the bucket that was not used for the longest time is replaced. All
+// lookups and updates are lock-free (compare-and-swap).
+class callsign_rate_limit
+{
+private:
+	const int      max_per_dt     { 0 };
+	const uint64_t dt_us          { 0 };
+	const bool     per_tranceiver { false };
+
+	callsign_bucket_t *buckets    { nullptr };
+	size_t             n_sets     { 0 };
+
+	const uint64_t     start_us   { 0 };
+
+	uint64_t pack_state(const uint64_t ms, const uint64_t tokens) const { return (ms << 24) | tokens; }
+
+	callsign_bucket_t * find_bucket(const uint64_t key, const uint64_t now_ms);
+
+public:
+	callsign_rate_limit(const callsign_rate_limit_t & pars);
+	virtual ~callsign_rate_limit();
+
+	// true: within the rate
+	bool check(const std::string & callsign, const void *const source, const uint64_t now_us);
+
+	// messages without a "from" are always allowed
+	bool check(const message & m);
+
+	static callsign_rate_limit *instantiate(const libconfig::Setting & node);
+};
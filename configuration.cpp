@@ -9,7 +9,8 @@
 #include "tranceiver-aprs-si.h"
 
 
-configuration::configuration(const std::string & file, work_queue_t *const w, snmp_data *const sd, stats *const st)
+configuration::configuration(const std::string & file, work_queue_t *const w, snmp_data *const sd, stats *const st) :
+	w(w)
 {
 	try {
 		libconfig::Config cfg;
@@ -18,6 +19,27 @@ configuration::configuration(const std::string & file, work_queue_t *const w, sn
 
 		const libconfig::Setting & root = cfg.getRoot();
 
+		// the general settings (e.g. the number of dispatch workers) are
+		// needed before the tranceivers are instantiated
+		for(int i=0; i<root.getLength(); i++) {
+			const libconfig::Setting & node = root[i];
+
+			if (std::string(node.getName()) == "general")
+				load_general(node);
+		}
+
+		work_queue_init(w, dispatch_workers, dispatch_queue_size);
+
+		r  = new reactor(reactor_threads, use_io_uring);
+
+		sb = new switchboard(st, routing_cache_size);
+
+		if (dissect_cache_size > 0) {
+			dc = new dissect_cache(dissect_cache_size, st);
+
+			message::set_dissect_cache(dc);
+		}
+
 		for(int i=0; i<root.getLength(); i++) {
 			const libconfig::Setting & node = root[i];
 
@@ -27,7 +49,7 @@ configuration::configuration(const std::string & file, work_queue_t *const w, sn
 				load_filters(node);
 			}
 			else if (node_name == "general") {
-				load_general(node);
+				// already processed
 			}
 			else if (node_name == "tranceivers") {
 				load_tranceivers(node, w, sd, st, &ws);
@@ -74,6 +96,8 @@ configuration::~configuration()
 	for(auto t : tranceivers)
 		delete t;
 
+	delete r;
+
 	delete d;
 
 	if (global_repetition_filter) {
@@ -82,7 +106,15 @@ configuration::~configuration()
 		delete global_repetition_filter;
 	}
 
+	delete global_callsign_limit;
+
+	message::set_dissect_cache(nullptr);
+
+	delete dc;
+
 	delete gps;
+
+	work_queue_free(w);
 }
 
 void configuration::load_tranceivers(const libconfig::Setting & node_in, work_queue_t *const w, snmp_data *const sd, stats *const st, ws_global_context_t *const ws) {
@@ -108,6 +140,8 @@ void configuration::load_tranceivers(const libconfig::Setting & node_in, work_qu
 
 		t->register_snmp_counters(st, interface_nr);
 
+		t->start_transmitter();
+
 		interface_nr++;
 	}
 }
@@ -124,9 +158,6 @@ tranceiver * configuration::find_tranceiver(const std::string & id)
 
 void configuration::load_bridge_switchboard(const libconfig::Setting & node_in)
 {
-	if (sb == nullptr)
-		sb = new switchboard();
-
         for(int i=0; i<node_in.getLength(); i++) {
                 const libconfig::Setting & node = node_in[i];
 
@@ -169,9 +200,6 @@ void configuration::load_bridge_switchboard(const libconfig::Setting & node_in)
 
 void configuration::load_routing_switchboard(const libconfig::Setting & node_in)
 {
-	if (sb == nullptr)
-		sb = new switchboard();
-
         for(int i=0; i<node_in.getLength(); i++) {
                 const libconfig::Setting & node = node_in[i];
 
@@ -205,14 +233,18 @@ void configuration::load_routing_switchboard(const libconfig::Setting & node_in)
 			t_route_via_interfaces.push_back(interface);
 		}
 
-		sb_routing_mapping_t *m = new sb_routing_mapping_t();
-
-		if (regcomp(&m->re_from_callsign, from_callsign.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+		if (callsign_matcher::is_valid(from_callsign) == false)
 			error_exit(false, "(line %d): \"from-callsign\": \"%s\" is not a valid regular expression", node.getSourceLine(), from_callsign.c_str());
 
-		if (regcomp(&m->re_to_callsign, to_callsign.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+		if (callsign_matcher::is_valid(to_callsign) == false)
 			error_exit(false, "(line %d): \"to-callsign\": \"%s\" is not a valid regular expression", node.getSourceLine(), to_callsign.c_str());
 
+		sb_routing_mapping_t *m = new sb_routing_mapping_t();
+
+		m->from_callsign  = from_callsign;
+
+		m->to_callsign    = to_callsign;
+
 		m->t_incoming_via = t_incoming_via;
 
 		m->t_outgoing_via = t_route_via_interfaces;
@@ -257,12 +289,56 @@ void configuration::load_general(const libconfig::Setting & node_in)
 			gps = gps_connector::instantiate(node);
 		else if (type == "logfile")
 			logfile = node_in.lookup(type).c_str();
+		else if (type == "dispatch-workers") {
+			dispatch_workers = node_in.lookup(type);
+
+			if (dispatch_workers < 1)
+				error_exit(false, "(line %d): dispatch-workers must be 1 or more", node.getSourceLine());
+		}
+		else if (type == "dispatch-queue-size") {
+			dispatch_queue_size = node_in.lookup(type);
+
+			if (dispatch_queue_size < 1)
+				error_exit(false, "(line %d): dispatch-queue-size must be 1 or more", node.getSourceLine());
+		}
+		else if (type == "routing-cache-size") {
+			routing_cache_size = node_in.lookup(type);
+
+			if (routing_cache_size < 0)
+				error_exit(false, "(line %d): routing-cache-size must be 0 or more", node.getSourceLine());
+		}
+		else if (type == "reactor-threads") {
+			reactor_threads = node_in.lookup(type);
+
+			if (reactor_threads < 1)
+				error_exit(false, "(line %d): reactor-threads must be 1 or more", node.getSourceLine());
+		}
+		else if (type == "io-backend") {
+			std::string backend = node_in.lookup(type).c_str();
+
+			if (backend == "io_uring")
+				use_io_uring = true;
+			else if (backend != "epoll")
+				error_exit(false, "(line %d): io-backend must be \"epoll\" or \"io_uring\"", node.getSourceLine());
+		}
+		else if (type == "dissect-cache-size") {
+			dissect_cache_size = node_in.lookup(type);
+
+			if (dissect_cache_size < 0)
+				error_exit(false, "(line %d): dissect-cache-size must be 0 or more", node.getSourceLine());
+		}
                 else if (type == "repetition-rate-limiting") {
 			if (global_repetition_filter)
 				error_exit(false, "(line %d): repetition-rate-limiting is already defined", node.getSourceLine());
 
                         global_repetition_filter = seen::instantiate(node);
                 }
+		else if (type == "callsign-rate-limiting") {
+			if (global_callsign_limit)
+				error_exit(false, "(line %d): callsign-rate-limiting is already defined", node.getSourceLine());
+
+			global_callsign_limit = callsign_rate_limit::instantiate(node);
+		}
 		else {
 			error_exit(false, "(line %d): General setting \"%s\" is not known", node.getSourceLine(), type.c_str());
 		}
@@ -303,7 +379,14 @@ void configuration::load_filters(const libconfig::Setting & node_in)
 		if (pattern.empty())
 			error_exit(false, "(line %d): No filter definition set for \"%s\"", node_in.getSourceLine(), name.c_str());
 
-		filter_t f { ignore_if_field_is_missing, pattern };
+		std::string error;
+
+		auto program = compile_filter(pattern, &error);
+
+		if (!program)
+			error_exit(false, "(line %d): Filter \"%s\" is invalid: %s", node.getSourceLine(), name.c_str(), error.c_str());
+
+		filter_t f { ignore_if_field_is_missing, pattern, program };
 
 		filters.insert({ name, f });
         }
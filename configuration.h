@@ -1,8 +1,11 @@
 #include <map>
 #include <vector>
 
+#include "callsign-rate-limit.h"
+#include "dissect-cache.h"
 #include "filter.h"
 #include "gps.h"
+#include "reactor.h"
 #include "seen.h"
 #include "snmp.h"
 #include "switchboard.h"
@@ -14,6 +17,8 @@
 class configuration
 {
 private:
+	work_queue_t              *const w   { nullptr };
+
 	std::vector<tranceiver *>  tranceivers;
 
 	switchboard               *sb        { nullptr };
@@ -28,12 +33,25 @@ private:
 
 	std::string                logfile   { "gateway.log" };
 
+	int                        dispatch_workers    { 1    };
+	int                        dispatch_queue_size { 4096 };
+	int                        routing_cache_size  { 4096 };
+	int                        dissect_cache_size  { 1024 };
+
 	gps_connector             *gps       { nullptr };
 
 	std::map<std::string, filter_t> filters;
 
 	seen                      *global_repetition_filter { nullptr };
 
+	callsign_rate_limit       *global_callsign_limit    { nullptr };
+
+	dissect_cache             *dc        { nullptr };
+
+	int                        reactor_threads     { 2    };
+	bool                       use_io_uring        { false };
+	reactor                   *r         { nullptr };
+
 	snmp_data_type_running_since *running_since { new snmp_data_type_running_since() };
 
 	void load_bridge_switchboard(const libconfig::Setting & node);
@@ -62,6 +80,8 @@ public:
 
 	switchboard   * get_switchboard() const { return sb;        }
 
+	reactor       * get_reactor() const     { return r;         }
+
 	int             get_snmp_port() const   { return snmp_port; }
 
 	ws_global_context_t * get_websockets_context() { return &ws; }
@@ -71,4 +91,6 @@ public:
 	std::string   get_logfile() const       { return logfile;   }
 
 	seen          * get_global_repetition_filter() { return global_repetition_filter; }
+
+	callsign_rate_limit * get_global_callsign_limit() { return global_callsign_limit; }
 };
@@ -1,2 +1,3 @@
 int ok_crc(unsigned char *buf, int l);
 unsigned short int compute_crc(unsigned char *buf, int l);
+unsigned short int compute_crc_reference(unsigned char *buf, int l);
@@ -11,7 +11,6 @@
 
 #include "configuration.h"
 #include "db-mongodb.h"
-#include "dissect-packet.h"
 #include "gps.h"
 #include "log.h"
 #include "time.h"
@@ -359,16 +358,12 @@ std::vector<message> db_mongodb::get_history(const std::string & callsign, const
 
 				message m(tv, t, msg_id, bin_p, bin_size);
 
-				// TODO: move this into a function of some sort, see also tranceiver.cpp
-				auto        meta    = dissect_packet(bin_p, bin_size);
+				// the rest of the meta-data is dissected on first use
+				packet_meta meta;
 
-				if (meta.has_value()) {
-					meta.value().first.insert({ "air-time", db_record_gen(double(air_time)) });
+				meta.set(mk_air_time, db_record_gen(double(air_time)));
 
-					m.set_meta(meta.value().first);
-
-					delete meta.value().second;
-				}
+				m.set_meta(meta);
 
 				out.push_back(m);
 			}
@@ -0,0 +1,139 @@
+#include "configuration.h"
+#include "dispatcher.h"
+#include "log.h"
+#include "str.h"
+#include "time.h"
+#include "utils.h"
+
+
+dispatcher::dispatcher(configuration *const cfg, work_queue_t *const w, stats *const st) :
+	cfg(cfg),
+	w(w)
+{
+	size_t n_workers = w->shards.size();
+
+	for(size_t i=0; i<n_workers; i++) {
+		dispatcher_worker_stats_t ws;
+
+		ws.cnt_messages = st->register_stat(myformat("dispatcher-%zu-messages", i), myformat("1.3.6.1.2.1.4.57850.2.6.%zu.1", i + 1), snmp_integer::si_counter64);
+		ws.cnt_busy_us  = st->register_stat(myformat("dispatcher-%zu-busy-us",  i), myformat("1.3.6.1.2.1.4.57850.2.6.%zu.2", i + 1), snmp_integer::si_counter64);
+		ws.load         = st->register_stat(myformat("dispatcher-%zu-load",     i), myformat("1.3.6.1.2.1.4.57850.2.6.%zu.3", i + 1), snmp_integer::si_integer);
+
+		worker_stats.push_back(ws);
+	}
+
+	cnt_never_dissected = st->register_stat("forwarded-not-dissected", "1.3.6.1.2.1.4.57850.2.8", snmp_integer::si_counter64);
+
+	// dropped messages, per reason
+	cnt_drop_duplicate  = st->register_stat("dropped-duplicate",          "1.3.6.1.2.1.4.57850.2.9.1", snmp_integer::si_counter64);
+	cnt_drop_callsign   = st->register_stat("dropped-callsign-rate-limit", "1.3.6.1.2.1.4.57850.2.9.2", snmp_integer::si_counter64);
+
+	for(size_t i=0; i<n_workers; i++)
+		workers.push_back(new std::thread(std::ref(*this), i));
+
+	log(LL_INFO, "Started %zu dispatch worker(s)", n_workers);
+}
+
+dispatcher::~dispatcher()
+{
+	stop();
+}
+
+void dispatcher::stop()
+{
+	terminate = true;
+
+	for(auto shard : w->shards)
+		shard->wake();
+
+	for(auto th : workers) {
+		th->join();
+
+		delete th;
+	}
+
+	workers.clear();
+}
+
+void dispatcher::process(const message & m, const size_t worker_nr)
+{
+	stats_inc_counter(worker_stats.at(worker_nr).cnt_messages);
+
+	const tranceiver *t = m.get_source();
+
+	auto content = m.get_content();
+
+	seen *s = cfg->get_global_repetition_filter();
+
+	if (s) {
+		if (s->check(m) == false) {
+			t->mlog(LL_DEBUG, m, "process", "Dropped because of duplicates rate limiting");
+
+			stats_inc_counter(cnt_drop_duplicate);
+
+			return;
+		}
+	}
+
+	callsign_rate_limit *crl = cfg->get_global_callsign_limit();
+
+	if (crl) {
+		if (crl->check(m) == false) {
+			t->mlog(LL_DEBUG, m, "process", "Dropped because of callsign rate limiting");
+
+			stats_inc_counter(cnt_drop_callsign);
+
+			return;
+		}
+	}
+
+	t->mlog(LL_DEBUG_VERBOSE, m, "process", "Forwarding message from " + t->get_id() + ": " + dump_replace(content.first, content.second));
+
+	transmit_error_t rc = cfg->get_switchboard()->put_message(t, m, true);
+
+	if (rc != TE_ok)
+		t->mlog(LL_INFO, m, "process", myformat("Switchboard indicated error during put_message: %d", rc));
+	else
+		m.set_never_dissected_counter(cnt_never_dissected);  // counted when the last copy is freed
+}
+
+void dispatcher::operator()(const size_t worker_nr)
+{
+	set_thread_name(myformat("dispatch-%zu", worker_nr));
+
+	work_shard_t              *shard  = w->shards.at(worker_nr);
+
+	dispatcher_worker_stats_t &ws     = worker_stats.at(worker_nr);
+
+	uint64_t window_start = get_us();
+	uint64_t window_busy  = 0;
+
+	while(!terminate) {
+		// stop() wakes us up, the timeout is for updating the load
+		auto m = shard->pop(1000);
+
+		if (m.has_value()) {
+			uint64_t start_ts = get_us();
+
+			process(*m.value(), worker_nr);
+
+			delete m.value();
+
+			uint64_t took     = get_us() - start_ts;
+
+			stats_add_counter(ws.cnt_busy_us, took);
+
+			window_busy += took;
+		}
+
+		// also update the load when idle so that it drops to 0
+		uint64_t now = get_us();
+
+		if (now - window_start >= 1000000) {
+			stats_set(ws.load, window_busy * 1000 / (now - window_start));
+
+			window_start = now;
+			window_busy  = 0;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "message.h"
+#include "stats.h"
+#include "work.h"
+
+
+class configuration;
+
+typedef struct {
+	uint64_t *cnt_messages { nullptr };
+	uint64_t *cnt_busy_us  { nullptr };
+	uint64_t *load         { nullptr };  // per mille, over the last second
+} dispatcher_worker_stats_t;
+
+class dispatcher
+{
+private:
+	configuration *const cfg { nullptr };
+	work_queue_t  *const w   { nullptr };
+
+	std::vector<dispatcher_worker_stats_t> worker_stats;
+	uint64_t                              *cnt_never_dissected { nullptr };
+	uint64_t                              *cnt_drop_duplicate  { nullptr };
+	uint64_t                              *cnt_drop_callsign   { nullptr };
+	std::vector<std::thread *>             workers;
+
+	std::atomic_bool terminate { false };
+
+	void process(const message & m, const size_t worker_nr);
+
+public:
+	dispatcher(configuration *const cfg, work_queue_t *const w, stats *const st);
+	virtual ~dispatcher();
+
+	void stop();
+
+	void operator()(const size_t worker_nr);
+};
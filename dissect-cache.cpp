@@ -0,0 +1,51 @@
+#include <string.h>
+
+#include "dissect-cache.h"
+#include "dissect-packet.h"
+
+
+dissect_cache::dissect_cache(const size_t max_size, stats *const st) :
+	cache(max_size)
+{
+	if (st) {
+		cnt_hit  = st->register_stat("dissect-cache-hit",  "1.3.6.1.2.1.4.57850.2.10.1", snmp_integer::si_counter64);
+		cnt_miss = st->register_stat("dissect-cache-miss", "1.3.6.1.2.1.4.57850.2.10.2", snmp_integer::si_counter64);
+	}
+}
+
+dissect_cache::~dissect_cache()
+{
+}
+
+packet_meta dissect_cache::dissect(const buffer & content, const uint32_t digest)
+{
+	auto entry = cache.get(digest);
+
+	if (entry.has_value()) {
+		const buffer & cached = entry.value()->content;
+
+		if (cached.get_size() == content.get_size() && memcmp(cached.get_pointer(), content.get_pointer(), content.get_size()) == 0) {
+			stats_inc_counter(cnt_hit);
+
+			return entry.value()->meta;
+		}
+	}
+
+	stats_inc_counter(cnt_miss);
+
+	auto new_entry = std::make_shared<dissect_cache_entry_t>();
+
+	new_entry->content = content;
+
+	auto fields = dissect_packet(content.get_pointer(), content.get_size());
+
+	if (fields.has_value()) {
+		new_entry->meta = fields.value().first;
+
+		delete fields.value().second;
+	}
+
+	cache.put(digest, new_entry);
+
+	return new_entry->meta;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "lru-cache.h"
+#include "packet-meta.h"
+#include "stats.h"
+
+
+typedef struct {
+	buffer      content;  // digests can collide: verified on a hit
+	packet_meta meta;     // what dissect_packet() found
+} dissect_cache_entry_t;
+
+// The same frame often arrives via several tranceivers (and is read
+// again for the history in the web-interface); this remembers what
+// dissect_packet() returned for the most recent frames.
+class dissect_cache
+{
+private:
+	lru_cache<uint32_t, std::shared_ptr<const dissect_cache_entry_t> > cache;
+
+	uint64_t *cnt_hit  { nullptr };
+	uint64_t *cnt_miss { nullptr };
+
+public:
+	dissect_cache(const size_t max_size, stats *const st);
+	virtual ~dissect_cache();
+
+	packet_meta dissect(const buffer & content, const uint32_t digest);
+};
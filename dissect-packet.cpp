@@ -1,11 +1,14 @@
+#include <algorithm>
+
 #include "ax25.h"
 #include "dissect-packet.h"
 #include "gps.h"
+#include "hashing.h"
 #include "log.h"
 #include "str.h"
 
 
-std::optional<std::pair<std::map<std::string, db_record_data>, ax25 *> > parse_ax25(const uint8_t *const data, const size_t len)
+std::optional<std::pair<packet_meta, ax25 *> > parse_ax25(const uint8_t *const data, const size_t len)
 {
 	if (len < 16)
 		return { };
@@ -25,48 +28,48 @@ std::optional<std::pair<std::map<std::string, db_record_data>, ax25 *> > parse_a
 
 	ax25 *packet = new ax25(std::vector<uint8_t>(data, &data[len]));
 
-	std::map<std::string, db_record_data> fields;
+	packet_meta fields;
 
-	fields.insert({ "protocol", db_record_gen("AX.25") });
+	fields.set(mk_protocol, db_record_gen("AX.25"));
 
-	fields.insert({ "from", db_record_gen(packet->get_from().get_address()) });
+	fields.set(mk_from, db_record_gen(packet->get_from().get_address()));
 
-	fields.insert({ "to",   db_record_gen(packet->get_to  ().get_address()) });
+	fields.set(mk_to,   db_record_gen(packet->get_to  ().get_address()));
 
 	buffer payload = packet->get_data();
 
-	fields.insert({ "payload",  db_record_gen(dump_replace(payload.get_pointer(), payload.get_size())) });
+	fields.set(mk_payload, db_record_gen(dump_replace(payload.get_pointer(), payload.get_size())));
 
 	auto pid = packet->get_pid();
 
 	if (pid.has_value()) {
 		switch(pid.value()) {
 			case 0x01:  // ISO 8208/CCITT X.25 PLP
-				fields.insert({ "payload-protocol", db_record_gen("X.25") }); break;
+				fields.set("payload-protocol", db_record_gen("X.25")); break;
 			case 0x06:  // Compressed TCP/IP packet
-				fields.insert({ "payload-protocol", db_record_gen("compressed TCP/IP") }); break;
+				fields.set("payload-protocol", db_record_gen("compressed TCP/IP")); break;
 			case 0x07:  // Uncompressed TCP/IP packet
-				fields.insert({ "payload-protocol", db_record_gen("uncompressed TCP/IP") }); break;
+				fields.set("payload-protocol", db_record_gen("uncompressed TCP/IP")); break;
 			case 0x08:  // Segmentation fragment
-				fields.insert({ "payload-protocol", db_record_gen("segmentation fragment") }); break;	
+				fields.set("payload-protocol", db_record_gen("segmentation fragment")); break;	
 			case 0xc3:  // Text Telephone
-				fields.insert({ "payload-protocol", db_record_gen("TEXNET") }); break;
+				fields.set("payload-protocol", db_record_gen("TEXNET")); break;
 			case 0xc4:  // Link Quality Protocol
-				fields.insert({ "payload-protocol", db_record_gen("LQP") }); break;
+				fields.set("payload-protocol", db_record_gen("LQP")); break;
 			case 0xca:  // Appletalk
-				fields.insert({ "payload-protocol", db_record_gen("Appletalk") }); break;
+				fields.set("payload-protocol", db_record_gen("Appletalk")); break;
 			case 0xcb:  // Appletalk ARP
-				fields.insert({ "payload-protocol", db_record_gen("Appletalk ARP") }); break;
+				fields.set("payload-protocol", db_record_gen("Appletalk ARP")); break;
 			case 0xcc:  // ARPA Internet Protocol
-				fields.insert({ "payload-protocol", db_record_gen("IP") }); break;
+				fields.set("payload-protocol", db_record_gen("IP")); break;
 			case 0xcd:  // ARPA Address Resolution Protocol
-				fields.insert({ "payload-protocol", db_record_gen("ARP") }); break;
+				fields.set("payload-protocol", db_record_gen("ARP")); break;
 			case 0xce:  // FlexNet
-				fields.insert({ "payload-protocol", db_record_gen("FlexNet") }); break;
+				fields.set("payload-protocol", db_record_gen("FlexNet")); break;
 			case 0xcf:  // NET/ROM
-				fields.insert({ "payload-protocol", db_record_gen("NET/ROM") }); break;
+				fields.set("payload-protocol", db_record_gen("NET/ROM")); break;
 			case 0xf0:  // no layer 3
-				fields.insert({ "payload-protocol", db_record_gen("NMEA") }); break;
+				fields.set("payload-protocol", db_record_gen("NMEA")); break;
 			case 0xff:  // next byte contains more info
 				log(LL_WARNING, "AX.25: \"next byte contains more info\" - UNHANDLED");
 				break;
@@ -76,7 +79,7 @@ std::optional<std::pair<std::map<std::string, db_record_data>, ax25 *> > parse_a
 	return { { fields, packet } };
 }
 
-std::optional<std::map<std::string, db_record_data> > parse_aprs(const uint8_t *const data, const size_t len)
+std::optional<packet_meta> parse_aprs(const uint8_t *const data, const size_t len)
 {
 	if (len < 6)
 		return { };
@@ -86,7 +89,7 @@ std::optional<std::map<std::string, db_record_data> > parse_aprs(const uint8_t *
 
 	// might be an APRS packet
 
-	std::map<std::string, db_record_data> fields;
+	packet_meta fields;
 
 	const std::string work(reinterpret_cast<const char *>(data), len);
 
@@ -111,9 +114,9 @@ std::optional<std::map<std::string, db_record_data> > parse_aprs(const uint8_t *
 
                         from    = work.substr(3, gt - 3);
 
-			fields.insert({ "from", from });
+			fields.set(mk_from, from);
 
-			fields.insert({ "to",   to   });
+			fields.set(mk_to,   to  );
 		}
 	}
 
@@ -136,9 +139,9 @@ std::optional<std::map<std::string, db_record_data> > parse_aprs(const uint8_t *
 		auto position = parse_nmea_pos(nmea.c_str());
 
 		if (position.has_value()) {
-			fields.insert({ "latitude",  db_record_gen(position.value().first)  });
+			fields.set(mk_latitude,  db_record_gen(position.value().first ));
 
-			fields.insert({ "longitude", db_record_gen(position.value().second) });
+			fields.set(mk_longitude, db_record_gen(position.value().second));
 		}
 
 		if (chars_left >= 20) {
@@ -220,26 +223,26 @@ std::optional<std::map<std::string, db_record_data> > parse_aprs(const uint8_t *
 			}
 
 			if (symbol.empty() == false)
-				fields.insert({ "station-type", db_record_gen(symbol) });
+				fields.set("station-type", db_record_gen(symbol));
 		}
 	}
 	else if (command == '$') {
-		fields.insert({ "payload",   db_record_gen(work.substr(colon + 2)) });
+		fields.set(mk_payload, db_record_gen(work.substr(colon + 2)));
 
-		fields.insert({ "payload-protocol", db_record_gen("NMEA") });
+		fields.set("payload-protocol", db_record_gen("NMEA"));
 	}
 
         std::size_t bracket = work.find('[');
 
-	if (bracket != std::string::npos)
-		fields.insert({ "payload",   db_record_gen(work.substr(bracket + 1)) });
+	if (bracket != std::string::npos && fields.find(mk_payload) == nullptr)
+		fields.set(mk_payload, db_record_gen(work.substr(bracket + 1)));
 
-	fields.insert({ "protocol", db_record_gen("APRS-OE") });
+	fields.set(mk_protocol, db_record_gen("APRS-OE"));
 
 	return fields;
 }
 
-std::optional<std::pair<std::map<std::string, db_record_data>, ax25 *> > dissect_packet(const uint8_t *const data, const size_t len)
+std::optional<std::pair<packet_meta, ax25 *> > dissect_packet(const uint8_t *const data, const size_t len)
 {
 	auto aprs = parse_aprs(data, len);
 
@@ -253,3 +256,69 @@ std::optional<std::pair<std::map<std::string, db_record_data>, ax25 *> > dissect
 
 	return { };
 }
+
+static void append_ax25_address(std::string *const out, const uint8_t *const p)
+{
+	for(int i=0; i<6; i++) {
+		char c = char(p[i] >> 1);
+
+		if (c != ' ')
+			*out += c;
+	}
+
+	int ssid = (p[6] >> 1) & 0x0f;
+
+	if (ssid)
+		*out += myformat("-%d", ssid);
+}
+
+std::optional<uint32_t> calc_aprs_digest(const uint8_t *const p, const size_t size)
+{
+	std::string key;
+
+	if (size >= 4 && p[0] == '<' && p[1] == 0xff && p[2] == 0x01) {
+		const char *const begin = reinterpret_cast<const char *>(&p[3]);
+		const char *const end   = reinterpret_cast<const char *>(&p[size]);
+
+		const char *gt     = std::find(begin, end, '>');
+		const char *colon  = std::find(gt,    end, ':');
+
+		if (gt == end || colon == end)
+			return { };
+
+		const char *to_end = std::find(gt, colon, ',');  // path starts at the comma
+
+		key.assign(begin, to_end);
+		key.append(colon, end);
+	}
+	else {
+		// to, from, up to 8 digipeaters; the last address has bit 0 set
+		size_t offset = 0;
+
+		for(;;) {
+			if (offset + 7 > size || offset >= 10 * 7)
+				return { };
+
+			offset += 7;
+
+			if (p[offset - 1] & 1)
+				break;
+		}
+
+		// only UI-frames with "no layer 3" carry APRS
+		if (offset < 14 || offset + 2 > size || (p[offset] & ~0x10) != 0x03 || p[offset + 1] != 0xf0)
+			return { };
+
+		append_ax25_address(&key, &p[7]);
+		key += '>';
+		append_ax25_address(&key, &p[0]);
+		key += ':';
+		key.append(reinterpret_cast<const char *>(&p[offset + 2]), size - offset - 2);
+	}
+
+	// some gateways add a line ending
+	while(key.empty() == false && (key.back() == '\r' || key.back() == '\n'))
+		key.pop_back();
+
+	return calc_digest(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
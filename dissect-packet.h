@@ -5,6 +5,12 @@
 
 #include "ax25.h"
 #include "db-common.h"
+#include "packet-meta.h"
 
 
-std::optional<std::pair<std::map<std::string, db_record_data>, ax25 *> > dissect_packet(const uint8_t *const p, const size_t size);
+std::optional<std::pair<packet_meta, ax25 *> > dissect_packet(const uint8_t *const p, const size_t size);
+
+// digest of "from>to:information" of an APRS packet (OE-style or AX.25
+// UI frame), i.e. without the digipeater/q-construct path; nothing if
+// the packet is not APRS
+std::optional<uint32_t> calc_aprs_digest(const uint8_t *const p, const size_t size);
@@ -1,5 +1,5 @@
-#include <ctype.h>
 #include <optional>
+#include <stdlib.h>
 
 #include "error.h"
 #include "filter.h"
@@ -30,11 +30,136 @@ std::optional<std::string> retrieve_subfilter(const std::string & in)
 	return { };  // end of subfilter not found
 }
 
-bool execute_filter(const std::string & filter, const bool ignore_if_field_is_missing, const message & m)
+static std::optional<double> parse_number(const std::string & in)
 {
-	std::size_t position  = 0;
-	std::string operation;
-	bool        rc        = false;
+	if (in.empty())
+		return { };
+
+	char  *end = nullptr;
+
+	double v   = strtod(in.c_str(), &end);
+
+	if (*end != 0x00)
+		return { };
+
+	return v;
+}
+
+static bool parse_comparison(const std::string & filter, std::size_t *const position, filter_term_t *const term, std::string *const error)
+{
+	std::size_t op_start = filter.find_first_of("=!<>", *position);
+
+	if (op_start == std::string::npos) {
+		*error = myformat("no comparison operator found at offset %zu", *position);
+
+		return false;
+	}
+
+	term->field = trim(filter.substr(*position, op_start - *position));
+
+	if (term->field.empty()) {
+		*error = myformat("field name missing at offset %zu", *position);
+
+		return false;
+	}
+
+	term->field_key = packet_meta_key(term->field);
+
+	std::string op        = filter.substr(op_start, 2);
+	std::size_t op_length = 2;
+
+	if (op == "!=")
+		term->op = fo_not_equal;
+	else if (op == "<=")
+		term->op = fo_less_equal;
+	else if (op == ">=")
+		term->op = fo_greater_equal;
+	else {
+		op_length = 1;
+
+		if (op[0] == '=')
+			term->op = fo_equal;
+		else if (op[0] == '<')
+			term->op = fo_less;
+		else if (op[0] == '>')
+			term->op = fo_greater;
+		else {
+			*error = myformat("unknown operator at offset %zu", op_start);
+
+			return false;
+		}
+	}
+
+	std::size_t value_start = op_start + op_length;
+	bool        quoted      = value_start < filter.size() && filter[value_start] == '"';
+
+	if (quoted) {
+		std::size_t dq = filter.find('"', value_start + 1);
+
+		if (dq == std::string::npos) {
+			*error = myformat("end of string starting at offset %zu not found", value_start);
+
+			return false;
+		}
+
+		term->value = filter.substr(value_start + 1, dq - value_start - 1);
+
+		*position   = dq + 1;
+	}
+	else {
+		std::size_t value_end = filter.find(' ', value_start);
+
+		if (value_end == std::string::npos)
+			value_end = filter.size();
+
+		term->value = filter.substr(value_start, value_end - value_start);
+
+		*position   = value_end;
+
+		if (term->value.empty()) {
+			*error = myformat("value missing for field \"%s\"", term->field.c_str());
+
+			return false;
+		}
+	}
+
+	auto number = parse_number(term->value);
+
+	term->value_is_number = number.has_value();
+	term->value_number    = number.has_value() ? number.value() : 0.;
+
+	std::size_t dots = quoted ? std::string::npos : term->value.find("..");
+
+	if (dots != std::string::npos && (term->op == fo_equal || term->op == fo_not_equal)) {
+		auto low  = parse_number(term->value.substr(0, dots));
+		auto high = parse_number(term->value.substr(dots + 2));
+
+		if (low.has_value() == false || high.has_value() == false) {
+			*error = myformat("invalid range \"%s\" for field \"%s\"", term->value.c_str(), term->field.c_str());
+
+			return false;
+		}
+
+		term->op                = term->op == fo_equal ? fo_in_range : fo_not_in_range;
+		term->value_number      = low.value();
+		term->value_number_high = high.value();
+	}
+	else if (term->op != fo_equal && term->op != fo_not_equal && term->value_is_number == false) {
+		*error = myformat("\"%s\" is not a number (field \"%s\")", term->value.c_str(), term->field.c_str());
+
+		return false;
+	}
+
+	return true;
+}
+
+std::shared_ptr<const filter_expression> compile_filter(const std::string & filter, std::string *const error)
+{
+	auto          out      = std::make_shared<filter_expression>();
+
+	std::size_t   position = 0;
+	filter_join_t join     = fj_first;
+	bool          expect_term = true;
 
 	while(position < filter.size()) {
 		if (filter[position] == ' ') {
@@ -43,86 +168,204 @@ bool execute_filter(const std::string & filter, const bool ignore_if_field_is_mi
 			continue;
 		}
 
+		if (filter[position] == '&' || filter[position] == '|') {
+			std::size_t token_end = filter.find_first_of(" ", position);
+
+			std::string operation = filter.substr(position, token_end - position);
+
+			if (expect_term) {
+				*error = myformat("unexpected \"%s\" at offset %zu", operation.c_str(), position);
+
+				return nullptr;
+			}
+
+			if (operation == "&&")
+				join = fj_and;
+			else if (operation == "||")
+				join = fj_or;
+			else {
+				*error = myformat("unknown operation \"%s\" at offset %zu", operation.c_str(), position);
+
+				return nullptr;
+			}
+
+			expect_term = true;
+
+			position    = token_end;
+
+			continue;
+		}
+
+		if (expect_term == false) {
+			*error = myformat("\"&&\" or \"||\" expected at offset %zu", position);
+
+			return nullptr;
+		}
+
+		filter_term_t term { };
+
+		term.join = join;
+
 		if (filter[position] == '(') {
 			auto temp = retrieve_subfilter(filter.substr(position + 1));
 
-			if (temp.has_value() == false)
-				error_exit(false, "End of sub-filter not found");
+			if (temp.has_value() == false) {
+				*error = myformat("end of sub-filter starting at offset %zu not found", position);
 
-			bool cur_rc = execute_filter(temp.value(), ignore_if_field_is_missing, m);
+				return nullptr;
+			}
 
-			if (operation.empty())
-				rc = cur_rc;
-			else if (operation == "&&")
-				rc = rc && cur_rc;
-			else if (operation == "||")
-				rc = rc || cur_rc;
-			else
-				error_exit(false, "Unknown operation \"%s\"", operation.c_str());
+			term.sub = compile_filter(temp.value(), error);
 
-			operation.clear();
+			if (!term.sub)
+				return nullptr;
 
 			position += temp.value().size() + 2;
 		}
-		else if (filter[position] == '&' || filter[position] == '|') {
-			std::size_t token_end = filter.find_first_of(" ", position);
+		else if (parse_comparison(filter, &position, &term, error) == false) {
+			return nullptr;
+		}
 
-			operation = filter.substr(position, token_end - position);
+		out->terms.push_back(term);
 
-			position = token_end;
-		}
-		else {
-			std::size_t equal_sign  = filter.find_first_of("=",  position);
-			std::size_t nequal_sign = filter.find_first_of("!=", position);
+		expect_term = false;
+	}
 
-			std::size_t splitter    = (equal_sign != std::string::npos && equal_sign < nequal_sign) || nequal_sign == std::string::npos ? equal_sign : nequal_sign;
-			bool        equals      = splitter == equal_sign;
-			int         compare_len = equals ? 1 : 2;
+	if (out->terms.empty()) {
+		*error = "empty filter";
 
-			std::string left        = trim(filter.substr(position, splitter - position));
+		return nullptr;
+	}
 
-			std::size_t right_end   = filter.find_first_of(" ", splitter + compare_len);
+	if (expect_term) {
+		*error = "filter ends with an operation";
 
-			std::string right       = trim(filter.substr(splitter + compare_len, right_end - splitter - compare_len));
+		return nullptr;
+	}
 
-			if (right[0] == '"') {
-				std::size_t dq  = filter.find_first_of("\"", splitter + 1 + compare_len);
+	return out;
+}
 
-				right           = filter.substr(splitter + 1 + compare_len, dq - splitter - (1 + compare_len));
+static bool execute_expression(const filter_expression & e, const bool ignore_if_field_is_missing, const message & m);
 
-				right_end       = dq + 1;
-			}
+static std::optional<double> get_field_number(const db_record_data & field)
+{
+	switch(field.dt) {
+		case dt_float64:
+			return field.d_value;
 
-			auto        field       = m.get_meta().find(left);
+		case dt_signed64:
+			return double(int64_t(field.i_value));
 
-			bool        cur_rc      = false;
+		case dt_string: {
+			// e.g. "12.34" or "-80dBm"
+			char  *end = nullptr;
 
-			if (field == m.get_meta().end()) {
-				if (ignore_if_field_is_missing == false)
-					error_exit(false, "Filter (%s): field \"%s\" not found", filter.c_str(), left.c_str());
+			double v   = strtod(field.s_value.c_str(), &end);
 
-				cur_rc = true;
-			}
-			else {
-				std::string value = field->second.s_value;
+			if (end == field.s_value.c_str())
+				return { };
 
-				cur_rc            = equals ? value == right : value != right;
-			}
+			return v;
+		}
 
-			if (operation.empty())
-				rc = cur_rc;
-			else if (operation == "&&")
-				rc = rc && cur_rc;
-			else if (operation == "||")
-				rc = rc || cur_rc;
-			else
-				error_exit(false, "Unknown operation \"%s\"", operation.c_str());
+		default:
+			break;
+	}
+
+	return { };
+}
+
+static bool execute_term(const filter_term_t & term, const bool ignore_if_field_is_missing, const message & m)
+{
+	if (term.sub)
+		return execute_expression(*term.sub, ignore_if_field_is_missing, m);
+
+	auto field = term.field_key != -1 ? m.get_meta().find(term.field_key) : m.get_meta().find(term.field);
 
-			position = right_end;
+	if (field == nullptr) {
+		if (ignore_if_field_is_missing == false)
+			log(LL_DEBUG, "Filter: field \"%s\" not found", term.field.c_str());
 
-			operation.clear();
+		return ignore_if_field_is_missing;
+	}
+
+	if (term.op == fo_equal || term.op == fo_not_equal) {
+		bool equal = false;
+
+		if (field->dt == dt_string || term.value_is_number == false)
+			equal = field->s_value == term.value;
+		else {
+			auto v = get_field_number(*field);
+
+			equal  = v.has_value() && v.value() == term.value_number;
 		}
+
+		return term.op == fo_equal ? equal : !equal;
+	}
+
+	auto v = get_field_number(*field);
+
+	if (v.has_value() == false)
+		return false;
+
+	switch(term.op) {
+		case fo_less:
+			return v.value() <  term.value_number;
+		case fo_less_equal:
+			return v.value() <= term.value_number;
+		case fo_greater:
+			return v.value() >  term.value_number;
+		case fo_greater_equal:
+			return v.value() >= term.value_number;
+		case fo_in_range:
+			return v.value() >= term.value_number && v.value() <= term.value_number_high;
+		case fo_not_in_range:
+			return v.value() <  term.value_number || v.value() >  term.value_number_high;
+		default:
+			break;
+	}
+
+	return false;
+}
+
+static bool execute_expression(const filter_expression & e, const bool ignore_if_field_is_missing, const message & m)
+{
+	bool rc = false;
+
+	for(auto & term : e.terms) {
+		// no need to evaluate when the outcome is already known
+		if (term.join == fj_and && rc == false)
+			continue;
+
+		if (term.join == fj_or && rc == true)
+			continue;
+
+		rc = execute_term(term, ignore_if_field_is_missing, m);
 	}
 
 	return rc;
 }
+
+bool execute_filter(const filter_t & f, const message & m)
+{
+	return execute_expression(*f.program, f.ignore_if_field_is_missing, m);
+}
+
+std::set<std::string> get_filter_fields(const filter_expression & e)
+{
+	std::set<std::string> out;
+
+	for(auto & term : e.terms) {
+		if (term.sub) {
+			auto sub_fields = get_filter_fields(*term.sub);
+
+			out.insert(sub_fields.begin(), sub_fields.end());
+		}
+		else {
+			out.insert(term.field);
+		}
+	}
+
+	return out;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <libconfig.h++>
+#include <memory>
 #include <regex.h>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -9,10 +11,47 @@
 #include "message.h"
 
 
+typedef enum { fj_first, fj_and, fj_or } filter_join_t;
+
+typedef enum { fo_equal, fo_not_equal, fo_less, fo_less_equal, fo_greater, fo_greater_equal, fo_in_range, fo_not_in_range } filter_operator_t;
+
+class filter_expression;
+
+// one "field<operator>value" comparison or one parenthesised sub-filter
+typedef struct
+{
+	filter_join_t      join;     // how to combine with the result so far
+
+	std::string        field;
+	int                field_key;  // packet_meta_key(field)
+	filter_operator_t  op;
+	std::string        value;
+	bool               value_is_number;
+	double             value_number;
+	double             value_number_high;  // for ranges ("low..high")
+
+	std::shared_ptr<const filter_expression> sub;
+} filter_term_t;
+
+// terms are evaluated from left to right, without operator precedence
+class filter_expression
+{
+public:
+	std::vector<filter_term_t> terms;
+};
+
 typedef struct
 {
 	bool        ignore_if_field_is_missing;
 	std::string pattern;
+
+	std::shared_ptr<const filter_expression> program;
 } filter_t;
 
-bool execute_filter(const std::string & pattern, const bool ignore_if_field_is_missing, const message & m);
+// returns nullptr (and a description in *error) on a syntax error
+std::shared_ptr<const filter_expression> compile_filter(const std::string & pattern, std::string *const error);
+
+bool execute_filter(const filter_t & f, const message & m);
+
+// names of the meta-data fields a filter looks at
+std::set<std::string> get_filter_fields(const filter_expression & e);
@@ -1,11 +1,257 @@
+#include <array>
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#endif
+
+#include "hashing.h"
 
 extern "C" {
 #include "crc_32.h"
 }
 
 
+// All kernels below compute the same CRC32 (ANSI X3.66, reflected
+// polynomial 0xedb88320) as crc32buf() in crc_32.c. They work on the
+// "state" (the inverted crc); calc_crc32() does the pre/post inversion.
+
+typedef uint32_t (*crc32_kernel_t)(uint32_t state, const uint8_t *p, size_t len);
+
+static constexpr std::array<std::array<uint32_t, 256>, 8> make_crc32_tables()
+{
+	std::array<std::array<uint32_t, 256>, 8> t { };
+
+	for(uint32_t i=0; i<256; i++) {
+		uint32_t c = i;
+
+		for(int k=0; k<8; k++)
+			c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+
+		t[0][i] = c;
+	}
+
+	for(uint32_t i=0; i<256; i++) {
+		for(int k=1; k<8; k++)
+			t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+	}
+
+	return t;
+}
+
+static constexpr auto crc32_tables = make_crc32_tables();
+
+static uint32_t crc32_bytewise(uint32_t state, const uint8_t *p, size_t len)
+{
+	while(len--)
+		state = crc32_tables[0][(state ^ *p++) & 0xff] ^ (state >> 8);
+
+	return state;
+}
+
+// slicing-by-8: 8 bytes per iteration, 8 independent table lookups
+static uint32_t crc32_slicing_by_8(uint32_t state, const uint8_t *p, size_t len)
+{
+	while(len >= 8) {
+		uint32_t lo = 0;
+		uint32_t hi = 0;
+
+		memcpy(&lo, &p[0], 4);
+		memcpy(&hi, &p[4], 4);
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		lo = __builtin_bswap32(lo);
+		hi = __builtin_bswap32(hi);
+#endif
+
+		lo ^= state;
+
+		state = crc32_tables[7][ lo        & 0xff] ^
+			crc32_tables[6][(lo >>  8) & 0xff] ^
+			crc32_tables[5][(lo >> 16) & 0xff] ^
+			crc32_tables[4][ lo >> 24        ] ^
+			crc32_tables[3][ hi        & 0xff] ^
+			crc32_tables[2][(hi >>  8) & 0xff] ^
+			crc32_tables[1][(hi >> 16) & 0xff] ^
+			crc32_tables[0][ hi >> 24        ];
+
+		p   += 8;
+		len -= 8;
+	}
+
+	return crc32_bytewise(state, p, len);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Carry-less multiplication folding ("Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ Instruction", Intel 2009): 4x128 bits are
+// folded per iteration, then reduced to 32 bits (Barrett).
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul(uint32_t state, const uint8_t *p, size_t len)
+{
+	if (len < 64)
+		return crc32_slicing_by_8(state, p, len);
+
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+	const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+	const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00));
+	__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10));
+	__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20));
+	__m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30));
+
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int(state)));
+
+	p   += 64;
+	len -= 64;
+
+	while(len >= 64) {
+		__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30)));
+
+		p   += 64;
+		len -= 64;
+	}
+
+	// fold 4x128 into 128 bits
+	for(__m128i next : { x2, x3, x4 }) {
+		__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, next), x5);
+	}
+
+	while(len >= 16) {
+		__m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p))), x5);
+
+		p   += 16;
+		len -= 16;
+	}
+
+	// 128 -> 64 bits
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), poly, 0x10);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	state = uint32_t(_mm_extract_epi32(x1, 1));
+
+	// the tail (< 16 bytes)
+	return crc32_slicing_by_8(state, p, len);
+}
+#endif
+
+#if defined(__aarch64__)
+// the ARMv8 CRC32 extension (crc32x/crc32b: the same polynomial)
+__attribute__((target("+crc")))
+static uint32_t crc32_arm(uint32_t state, const uint8_t *p, size_t len)
+{
+	while(len >= 8) {
+		uint64_t v = 0;
+
+		memcpy(&v, p, 8);
+
+		state = __crc32d(state, v);
+
+		p   += 8;
+		len -= 8;
+	}
+
+	while(len--)
+		state = __crc32b(state, *p++);
+
+	return state;
+}
+#endif
+
+static crc32_kernel_t select_crc32_kernel(const char **const name)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+		*name = "pclmul";
+
+		return crc32_pclmul;
+	}
+#elif defined(__aarch64__) && defined(HWCAP_CRC32)
+	if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+		*name = "arm-crc32";
+
+		return crc32_arm;
+	}
+#endif
+
+	*name = "slicing-by-8";
+
+	return crc32_slicing_by_8;
+}
+
+typedef struct {
+	crc32_kernel_t  kernel;
+	const char     *name;
+} crc32_selected_t;
+
+// on first use (thread safe), so that it also works from (other)
+// static initializers
+static const crc32_selected_t & get_crc32_kernel()
+{
+	static const crc32_selected_t selected = [] {
+		crc32_selected_t s { nullptr, nullptr };
+
+		s.kernel = select_crc32_kernel(&s.name);
+
+		return s;
+	}();
+
+	return selected;
+}
+
 uint32_t calc_crc32(const uint8_t *const p, const size_t len)
+{
+	return ~get_crc32_kernel().kernel(0xffffffff, p, len);
+}
+
+uint32_t calc_crc32_reference(const uint8_t *const p, const size_t len)
 {
 	return crc32buf(reinterpret_cast<char *>(const_cast<uint8_t *>(p)), len);
 }
+
+const char *calc_crc32_kernel_name()
+{
+	return get_crc32_kernel().name;
+}
+
+uint32_t calc_digest(const uint8_t *const p, const size_t len)
+{
+	return calc_crc32(p, len);
+}
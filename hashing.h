@@ -1,3 +1,14 @@
+#include <stddef.h>
 #include <stdint.h>
 
+// uses the fastest kernel the cpu supports (selected at startup)
 uint32_t calc_crc32(const uint8_t *const p, const size_t len);
+
+// the original byte-at-a-time implementation (crc_32.c), for verification
+uint32_t calc_crc32_reference(const uint8_t *const p, const size_t len);
+
+const char *calc_crc32_kernel_name();
+
+// the hash that identifies the content of a packet (duplicate detection,
+// "pkt-crc"); computed once per message, see message::get_digest()
+uint32_t calc_digest(const uint8_t *const p, const size_t len);
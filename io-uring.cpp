@@ -0,0 +1,758 @@
+#include "config.h"
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#if HAVE_URING
+#include <linux/io_uring.h>
+#endif
+
+#include "error.h"
+#include "io-uring.h"
+#include "log.h"
+#include "net.h"
+#include "str.h"
+#include "utils.h"
+
+
+#if HAVE_URING
+// user_data values below 16 are not receivers
+static constexpr uint64_t ud_ignore { 1 };
+static constexpr uint64_t ud_stop   { 2 };
+static constexpr uint64_t ud_probe  { 3 };
+
+// the rings that are shared with the kernel (no liburing: the system
+// calls and the uapi header are all that is needed)
+struct uring_ring_t {
+	int           fd         { -1      };
+
+	void         *map        { nullptr };
+	size_t        map_size   { 0       };
+	io_uring_sqe *sqes       { nullptr };
+	size_t        sqes_size  { 0       };
+
+	unsigned     *sq_head    { nullptr };
+	unsigned     *sq_tail    { nullptr };
+	unsigned     *sq_mask    { nullptr };
+	unsigned     *sq_array   { nullptr };
+	unsigned      sq_entries { 0       };
+
+	unsigned     *cq_head    { nullptr };
+	unsigned     *cq_tail    { nullptr };
+	unsigned     *cq_mask    { nullptr };
+	io_uring_cqe *cqes       { nullptr };
+};
+
+struct uring_receiver_t {
+	uint64_t            id        { 0     };
+	int                 fd        { -1    };
+	bool                is_socket { false };
+	io_uring_callback_t cb;
+
+	// only the lengths are used: the sender address ends up in the
+	// buffer, in front of the payload
+	msghdr              msg       { };
+	sockaddr_storage    from      { };
+
+	bool                stopping  { false };
+	bool                done      { false };  // no receive pending
+};
+
+static int sys_io_uring_setup(const unsigned entries, io_uring_params *const p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(const int fd, const unsigned to_submit, const unsigned min_complete, const unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(const int fd, const unsigned opcode, void *const arg, const unsigned nr_args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void ring_destroy(uring_ring_t *const r)
+{
+	if (r->sqes)
+		munmap(r->sqes, r->sqes_size);
+
+	if (r->map)
+		munmap(r->map, r->map_size);
+
+	if (r->fd != -1)
+		close(r->fd);
+
+	delete r;
+}
+
+static uring_ring_t *ring_create(const unsigned entries)
+{
+	io_uring_params p { };
+
+	int fd = sys_io_uring_setup(entries, &p);
+	if (fd == -1)
+		return nullptr;
+
+	uring_ring_t *r = new uring_ring_t;
+
+	r->fd = fd;
+
+	// kernels without this lack the other features that are used as well
+	if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+		ring_destroy(r);
+
+		errno = ENOSYS;
+
+		return nullptr;
+	}
+
+	r->map_size  = std::max(p.sq_off.array + p.sq_entries * sizeof(unsigned), p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+
+	void *map = mmap(nullptr, r->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (map == MAP_FAILED) {
+		ring_destroy(r);
+
+		return nullptr;
+	}
+
+	r->map       = map;
+
+	r->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+
+	void *sqes = mmap(nullptr, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		ring_destroy(r);
+
+		return nullptr;
+	}
+
+	r->sqes       = reinterpret_cast<io_uring_sqe *>(sqes);
+
+	uint8_t *base = reinterpret_cast<uint8_t *>(map);
+
+	r->sq_head    = reinterpret_cast<unsigned *>(base + p.sq_off.head);
+	r->sq_tail    = reinterpret_cast<unsigned *>(base + p.sq_off.tail);
+	r->sq_mask    = reinterpret_cast<unsigned *>(base + p.sq_off.ring_mask);
+	r->sq_array   = reinterpret_cast<unsigned *>(base + p.sq_off.array);
+	r->sq_entries = p.sq_entries;
+
+	r->cq_head    = reinterpret_cast<unsigned *>(base + p.cq_off.head);
+	r->cq_tail    = reinterpret_cast<unsigned *>(base + p.cq_off.tail);
+	r->cq_mask    = reinterpret_cast<unsigned *>(base + p.cq_off.ring_mask);
+	r->cqes       = reinterpret_cast<io_uring_cqe *>(base + p.cq_off.cqes);
+
+	return r;
+}
+
+// the caller does the locking; false: no room
+static bool ring_push(uring_ring_t *const r, const io_uring_sqe & sqe)
+{
+	unsigned tail = *r->sq_tail;
+	unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+
+	if (tail - head >= r->sq_entries)
+		return false;
+
+	unsigned index = tail & *r->sq_mask;
+
+	r->sqes[index]     = sqe;
+	r->sq_array[index] = index;
+
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static unsigned ring_pending(uring_ring_t *const r)
+{
+	return *r->sq_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+}
+
+// one reader per ring
+static bool ring_pop(uring_ring_t *const r, uint64_t *const user_data, int *const res, uint32_t *const flags)
+{
+	unsigned head = __atomic_load_n(r->cq_head, __ATOMIC_RELAXED);
+
+	if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+
+	const io_uring_cqe & cqe = r->cqes[head & *r->cq_mask];
+
+	*user_data = cqe.user_data;
+	*res       = cqe.res;
+	*flags     = cqe.flags;
+
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static io_uring_sqe prep_receive(const uring_receiver_t *const r, const size_t buffer_size)
+{
+	io_uring_sqe sqe { };
+
+	sqe.fd        = r->fd;
+	sqe.user_data = r->id;
+	sqe.flags     = IOSQE_BUFFER_SELECT;
+	sqe.buf_group = 0;
+
+	if (r->is_socket) {
+		// multishot: keeps on delivering until cancelled (or out of buffers)
+		sqe.opcode = IORING_OP_RECVMSG;
+		sqe.addr   = uintptr_t(&r->msg);
+		sqe.len    = 1;
+		sqe.ioprio = IORING_RECV_MULTISHOT;
+	}
+	else {
+		sqe.opcode = IORING_OP_READ;
+		sqe.off    = uint64_t(-1);  // current position (a tty has none)
+		sqe.len    = buffer_size;
+	}
+
+	return sqe;
+}
+
+static io_uring_sqe prep_cancel(const uint64_t user_data)
+{
+	io_uring_sqe sqe { };
+
+	sqe.opcode    = IORING_OP_ASYNC_CANCEL;
+	sqe.fd        = -1;
+	sqe.addr      = user_data;
+	sqe.user_data = ud_ignore;
+
+	return sqe;
+}
+
+io_uring_backend::io_uring_backend(const size_t n_buffers, const size_t buffer_size) :
+	n_buffers(n_buffers),
+	buffer_size(buffer_size)
+{
+}
+
+io_uring_backend::~io_uring_backend()
+{
+	stop();
+
+	for(auto & entry : receivers)
+		delete entry.second;
+
+	if (ring)
+		ring_destroy(ring);
+
+	if (buf_ring)
+		munmap(buf_ring, n_buffers * sizeof(io_uring_buf));
+
+	free(buffers);
+}
+
+bool io_uring_backend::setup()
+{
+	ring = ring_create(256);
+
+	if (!ring) {
+		log(LL_WARNING, "io_uring: setup failed: %s", strerror(errno));
+
+		return false;
+	}
+
+	// the kernel picks a buffer from this (page aligned) ring for each
+	// receive; it is handed back after the callback returned
+	void *br = mmap(nullptr, n_buffers * sizeof(io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (br == MAP_FAILED) {
+		log(LL_WARNING, "io_uring: cannot allocate buffer ring: %s", strerror(errno));
+
+		return false;
+	}
+
+	buf_ring = br;
+
+	buffers  = reinterpret_cast<uint8_t *>(malloc(n_buffers * buffer_size));
+
+	io_uring_buf_reg reg { };
+	reg.ring_addr    = uintptr_t(buf_ring);
+	reg.ring_entries = n_buffers;
+	reg.bgid         = 0;
+
+	if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+		log(LL_WARNING, "io_uring: cannot register buffers: %s", strerror(errno));
+
+		return false;
+	}
+
+	for(size_t i=0; i<n_buffers; i++)
+		return_buffer(i);
+
+	return probe_multishot();
+}
+
+// multishot recvmsg is newer than the buffer rings (linux 6.0)
+bool io_uring_backend::probe_multishot()
+{
+	uring_receiver_t probe;
+
+	probe.id        = ud_probe;
+	probe.fd        = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	probe.is_socket = true;
+	probe.msg.msg_name    = &probe.from;
+	probe.msg.msg_namelen = sizeof probe.from;
+
+	if (probe.fd == -1)
+		return false;
+
+	io_uring_sqe recv_sqe   = prep_receive(&probe, buffer_size);
+	io_uring_sqe cancel_sqe = prep_cancel(ud_probe);
+
+	bool ok = submit(&recv_sqe) && submit(&cancel_sqe);
+
+	int  rc = -ECANCELED;
+
+	while(ok) {
+		if (sys_io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR) {
+			ok = false;
+
+			break;
+		}
+
+		uint64_t user_data = 0;
+		int      res       = 0;
+		uint32_t flags     = 0;
+		bool     finished  = false;
+
+		while(ring_pop(ring, &user_data, &res, &flags)) {
+			if (user_data == ud_probe && (flags & IORING_CQE_F_MORE) == 0) {
+				rc       = res;
+				finished = true;
+			}
+		}
+
+		if (finished)
+			break;
+	}
+
+	close(probe.fd);
+
+	if (ok == false || rc != -ECANCELED) {
+		log(LL_WARNING, "io_uring: multishot receive not supported (%s)", strerror(ok ? -rc : errno));
+
+		return false;
+	}
+
+	return true;
+}
+
+io_uring_backend *io_uring_backend::create(const size_t n_buffers, const size_t buffer_size)
+{
+	io_uring_backend *u = new io_uring_backend(n_buffers, buffer_size);
+
+	if (u->setup() == false) {
+		delete u;
+
+		return nullptr;
+	}
+
+	u->th = new std::thread(&io_uring_backend::completions, u);
+
+	log(LL_INFO, "io_uring: started with %zu buffers of %zu bytes", n_buffers, buffer_size);
+
+	return u;
+}
+
+void io_uring_backend::stop()
+{
+	if (th == nullptr)
+		return;
+
+	io_uring_sqe sqe { };
+	sqe.opcode    = IORING_OP_NOP;
+	sqe.user_data = ud_stop;
+
+	if (submit(&sqe)) {
+		th->join();
+
+		delete th;
+
+		th = nullptr;
+	}
+}
+
+bool io_uring_backend::submit(const void *const sqe)
+{
+	std::unique_lock<std::mutex> lck(sq_lock);
+
+	if (ring_push(ring, *reinterpret_cast<const io_uring_sqe *>(sqe)) == false) {
+		log(LL_ERROR, "io_uring: submission queue full");
+
+		return false;
+	}
+
+	// no SQPOLL: the kernel takes the entries during this call
+	for(;;) {
+		if (sys_io_uring_enter(ring->fd, ring_pending(ring), 0, 0) != -1)
+			return true;
+
+		if (errno == EINTR)
+			continue;
+
+		// the entry stays in the ring, a next submit picks it up
+		if (errno == EAGAIN || errno == EBUSY)
+			return true;
+
+		log(LL_ERROR, "io_uring: submit failed: %s", strerror(errno));
+
+		return false;
+	}
+}
+
+// with "lock" locked
+bool io_uring_backend::submit_receive(uring_receiver_t *const r)
+{
+	io_uring_sqe sqe = prep_receive(r, buffer_size);
+
+	return submit(&sqe);
+}
+
+// only invoked from the completion thread (and from setup())
+void io_uring_backend::return_buffer(const uint16_t bid)
+{
+	// not br->bufs: in c++ the (empty struct of the) flexible array
+	// declaration in the uapi header moves it to offset 8
+	io_uring_buf_ring *br = reinterpret_cast<io_uring_buf_ring *>(buf_ring);
+	io_uring_buf      &b  = reinterpret_cast<io_uring_buf *>(buf_ring)[buf_tail & (n_buffers - 1)];
+
+	// not "b = ...": the resv field of the first one is the tail
+	b.addr = uintptr_t(buffers + bid * buffer_size);
+	b.len  = buffer_size;
+	b.bid  = bid;
+
+	buf_tail++;
+
+	__atomic_store_n(&br->tail, buf_tail, __ATOMIC_RELEASE);
+}
+
+void io_uring_backend::add(const int fd, const io_uring_callback_t & cb)
+{
+	struct stat st { };
+
+	uring_receiver_t *r = new uring_receiver_t;
+
+	r->fd        = fd;
+	r->is_socket = fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+	r->cb        = cb;
+	r->msg.msg_name    = &r->from;
+	r->msg.msg_namelen = sizeof r->from;
+
+	std::unique_lock<std::mutex> lck(lock);
+
+	r->id = next_id++;
+
+	receivers.insert({ r->id, r });
+
+	if (submit_receive(r) == false)
+		error_exit(false, "io_uring: cannot watch fd %d", fd);
+}
+
+void io_uring_backend::remove(const int fd)
+{
+	std::unique_lock<std::mutex> lck(lock);
+
+	auto it = std::find_if(receivers.begin(), receivers.end(), [fd](const auto & entry) { return entry.second->fd == fd; });
+
+	if (it == receivers.end())
+		return;
+
+	uring_receiver_t *r = it->second;
+
+	r->stopping = true;
+
+	if (r->done == false && th) {
+		io_uring_sqe sqe = prep_cancel(r->id);
+
+		if (submit(&sqe)) {
+			while(r->done == false)
+				cv.wait(lck);
+		}
+	}
+
+	receivers.erase(it);
+
+	delete r;
+}
+
+void io_uring_backend::handle_completion(const uint64_t user_data, const int res, const uint32_t flags)
+{
+	std::unique_lock<std::mutex> lck(lock);
+
+	auto it = receivers.find(user_data);
+
+	if (it == receivers.end()) {
+		if (flags & IORING_CQE_F_BUFFER)
+			return_buffer(flags >> IORING_CQE_BUFFER_SHIFT);
+
+		return;
+	}
+
+	// only deleted after "done" was set, which is done by this thread
+	uring_receiver_t *r = it->second;
+
+	bool keep = r->stopping == false;
+
+	lck.unlock();
+
+	try {
+		if (flags & IORING_CQE_F_BUFFER) {
+			uint16_t       bid = flags >> IORING_CQE_BUFFER_SHIFT;
+			const uint8_t *p   = buffers + bid * buffer_size;
+
+			if (keep && r->is_socket) {
+				// header, name (msg_namelen bytes), control, payload
+				const io_uring_recvmsg_out *out = reinterpret_cast<const io_uring_recvmsg_out *>(p);
+
+				size_t offset = sizeof(*out) + r->msg.msg_namelen + r->msg.msg_controllen;
+
+				if (size_t(res) < offset || (out->flags & MSG_TRUNC))
+					log(LL_WARNING, "io_uring: datagram on fd %d too large, dropped", r->fd);
+				else
+					keep = r->cb(p + offset, out->payloadlen, out->namelen ? reinterpret_cast<const sockaddr *>(p + sizeof(*out)) : nullptr);
+			}
+			else if (keep && res > 0) {
+				keep = r->cb(p, res, nullptr);
+			}
+
+			return_buffer(bid);
+		}
+		else if (res == 0 && r->is_socket == false) {  // end of file
+			if (keep)
+				keep = r->cb(nullptr, 0, nullptr);
+		}
+		else if (res < 0 && res != -ENOBUFS && res != -ECANCELED) {
+			log(LL_WARNING, "io_uring: receive on fd %d failed: %s", r->fd, strerror(-res));
+
+			// e.g. an icmp error for a socket is not fatal
+			keep = r->is_socket;
+		}
+	}
+	catch(const std::exception & e) {
+		log(LL_ERROR, "io_uring: exception in callback for fd %d: %s", r->fd, e.what());
+	}
+
+	lck.lock();
+
+	if ((flags & IORING_CQE_F_MORE) == 0) {
+		// a single-shot read, or the kernel ended the multishot receive
+		// (e.g. -ENOBUFS: the buffers are back by now)
+		if (keep && r->stopping == false && submit_receive(r))
+			return;
+
+		if (r->stopping == false)
+			log(LL_WARNING, "io_uring: no longer watching fd %d", r->fd);
+
+		r->stopping = true;
+		r->done     = true;
+
+		cv.notify_all();
+	}
+	else if (keep == false && r->stopping == false) {
+		log(LL_WARNING, "io_uring: no longer watching fd %d", r->fd);
+
+		r->stopping = true;
+
+		io_uring_sqe sqe = prep_cancel(r->id);
+
+		submit(&sqe);
+	}
+}
+
+void io_uring_backend::completions()
+{
+	set_thread_name("io_uring");
+
+	for(;;) {
+		if (sys_io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR) {
+			log(LL_ERROR, "io_uring: wait failed: %s", strerror(errno));
+
+			break;
+		}
+
+		uint64_t user_data = 0;
+		int      res       = 0;
+		uint32_t flags     = 0;
+		bool     stop      = false;
+
+		while(ring_pop(ring, &user_data, &res, &flags)) {
+			if (user_data == ud_stop)
+				stop = true;
+			else if (user_data >= 16)
+				handle_completion(user_data, res, flags);
+		}
+
+		if (stop)
+			break;
+	}
+}
+
+// one per transmitting thread (e.g. the transmitter of a tranceiver):
+// no locking needed
+struct uring_tx_ring_t {
+	uring_ring_t *ring   { nullptr };
+	bool          failed { false   };
+
+	~uring_tx_ring_t() {
+		if (ring)
+			ring_destroy(ring);
+	}
+};
+
+static thread_local uring_tx_ring_t tx_ring;
+
+static bool transmit_plain(const io_uring_send_t & item)
+{
+	if (item.to)
+		return sendto(item.fd, item.p, item.len, 0, item.to, item.to_len) == ssize_t(item.len);
+
+	return WRITE(item.fd, item.p, item.len) == ssize_t(item.len);
+}
+
+size_t io_uring_backend::transmit(std::vector<io_uring_send_t> & items)
+{
+	if (tx_ring.ring == nullptr && tx_ring.failed == false) {
+		tx_ring.ring   = ring_create(64);
+		tx_ring.failed = tx_ring.ring == nullptr;
+	}
+
+	size_t n_ok = 0;
+
+	for(auto & item : items)
+		item.sent = false;
+
+	if (tx_ring.ring == nullptr) {
+		for(auto & item : items) {
+			item.sent = transmit_plain(item);
+
+			n_ok += item.sent;
+		}
+
+		return n_ok;
+	}
+
+	uring_ring_t       *r = tx_ring.ring;
+
+	std::vector<msghdr> msgs(items.size());
+	std::vector<iovec>  iovs(items.size());
+
+	for(size_t offset=0; offset<items.size();) {
+		unsigned n = std::min(items.size() - offset, size_t(r->sq_entries));
+
+		for(unsigned i=0; i<n; i++) {
+			size_t                  nr   = offset + i;
+			const io_uring_send_t & item = items[nr];
+
+			io_uring_sqe sqe { };
+			sqe.fd        = item.fd;
+			sqe.user_data = nr;
+
+			if (item.to) {
+				iovs[nr].iov_base     = const_cast<uint8_t *>(item.p);
+				iovs[nr].iov_len      = item.len;
+
+				msgs[nr].msg_name     = const_cast<sockaddr *>(item.to);
+				msgs[nr].msg_namelen  = item.to_len;
+				msgs[nr].msg_iov      = &iovs[nr];
+				msgs[nr].msg_iovlen   = 1;
+
+				sqe.opcode = IORING_OP_SENDMSG;
+				sqe.addr   = uintptr_t(&msgs[nr]);
+				sqe.len    = 1;
+			}
+			else {
+				sqe.opcode = IORING_OP_WRITE;
+				sqe.addr   = uintptr_t(item.p);
+				sqe.len    = item.len;
+				sqe.off    = uint64_t(-1);
+			}
+
+			ring_push(r, sqe);
+		}
+
+		// submit all and wait for all of them
+		unsigned n_done = 0;
+
+		while(n_done < n) {
+			if (sys_io_uring_enter(r->fd, ring_pending(r), 1, IORING_ENTER_GETEVENTS) == -1) {
+				if (errno == EINTR)
+					continue;
+
+				log(LL_ERROR, "io_uring: transmit failed: %s", strerror(errno));
+
+				// the pending entries die with the ring
+				ring_destroy(r);
+
+				tx_ring.ring   = nullptr;
+				tx_ring.failed = true;
+
+				return n_ok;
+			}
+
+			uint64_t user_data = 0;
+			int      res       = 0;
+			uint32_t flags     = 0;
+
+			while(ring_pop(r, &user_data, &res, &flags)) {
+				io_uring_send_t & item = items[user_data];
+
+				n_done++;
+
+				if (res == ssize_t(item.len))
+					item.sent = true;
+				else if (res > 0 && item.to == nullptr)  // e.g. a tty: the rest
+					item.sent = WRITE(item.fd, item.p + res, item.len - res) == ssize_t(item.len - res);
+
+				n_ok += item.sent;
+			}
+		}
+
+		offset += n;
+	}
+
+	return n_ok;
+}
+#else
+io_uring_backend::io_uring_backend(const size_t n_buffers, const size_t buffer_size) :
+	n_buffers(n_buffers),
+	buffer_size(buffer_size)
+{
+}
+
+io_uring_backend::~io_uring_backend()
+{
+}
+
+io_uring_backend *io_uring_backend::create(const size_t n_buffers, const size_t buffer_size)
+{
+	log(LL_WARNING, "io_uring: not supported by this build");
+
+	return nullptr;
+}
+
+void io_uring_backend::stop()
+{
+}
+
+void io_uring_backend::add(const int fd, const io_uring_callback_t & cb)
+{
+}
+
+void io_uring_backend::remove(const int fd)
+{
+}
+
+size_t io_uring_backend::transmit(std::vector<io_uring_send_t> & items)
+{
+	return 0;
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+
+
+// "from": the sender of a datagram, nullptr for e.g. a tty. "len" 0 (and
+// "p" nullptr): end of file. Return false to stop receiving.
+typedef std::function<bool(const uint8_t *const p, const size_t len, const sockaddr *const from)> io_uring_callback_t;
+
+typedef struct {
+	int             fd;
+	const uint8_t  *p;
+	size_t          len;
+	const sockaddr *to;  // nullptr: write() instead of sendto()
+	socklen_t       to_len;
+	bool            sent;  // set by transmit()
+} io_uring_send_t;
+
+struct uring_ring_t;
+struct uring_receiver_t;
+
+// Alternative for the reactor (epoll) for the kiss and axudp tranceivers:
+// sockets are read with multishot recvmsg (one submission delivers all
+// datagrams), other file descriptors with read. The data lands in buffers
+// that are registered with the kernel (a provided-buffer ring), so no
+// buffer is passed per receive. All callbacks are invoked from one thread.
+class io_uring_backend
+{
+private:
+	uring_ring_t *ring        { nullptr };
+	std::mutex    sq_lock;  // submissions are done from any thread
+
+	uint8_t      *buffers     { nullptr };
+	const size_t  n_buffers   { 0       };  // power of 2
+	const size_t  buffer_size { 0       };
+	void         *buf_ring    { nullptr };
+	uint16_t      buf_tail    { 0       };  // only used by the completion thread
+
+	std::mutex    lock;
+	std::condition_variable cv;  // a receiver is done
+	std::map<uint64_t, uring_receiver_t *> receivers;
+	uint64_t      next_id     { 16      };  // below: internal use
+
+	std::thread  *th          { nullptr };
+
+	io_uring_backend(const size_t n_buffers, const size_t buffer_size);
+
+	bool setup();
+	bool probe_multishot();
+	bool submit(const void *const sqe);  // a struct io_uring_sqe
+	bool submit_receive(uring_receiver_t *const r);
+	void return_buffer(const uint16_t bid);
+	void handle_completion(const uint64_t user_data, const int res, const uint32_t flags);
+	void completions();
+
+public:
+	io_uring_backend(const io_uring_backend &) = delete;
+	virtual ~io_uring_backend();
+
+	// nullptr when not compiled in or when the kernel lacks support
+	static io_uring_backend *create(const size_t n_buffers, const size_t buffer_size);
+
+	void stop();
+
+	void add(const int fd, const io_uring_callback_t & cb);
+
+	// waits for a pending receive of fd to be cancelled
+	void remove(const int fd);
+
+	// everything in one system call (via a ring per calling thread);
+	// returns the number of items that were sent completely
+	size_t transmit(std::vector<io_uring_send_t> & items);
+};
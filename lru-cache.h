@@ -0,0 +1,91 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// Bounded least-recently-used cache. Split in shards (each with their
+// own lock) so that the dispatch workers do not all contend for one
+// mutex.
+template <typename K, typename V>
+class lru_cache
+{
+private:
+	typedef std::list<std::pair<K, V> > lru_list_t;
+
+	typedef struct {
+		std::mutex  lock;
+		lru_list_t  entries;  // most recently used at the front
+		std::unordered_map<K, typename lru_list_t::iterator> index;
+	} lru_shard_t;
+
+	static constexpr size_t n_shards { 16 };
+
+	const size_t               max_per_shard { 1 };
+	std::vector<lru_shard_t *> shards;
+
+	lru_shard_t * get_shard(const K & key) const {
+		return shards[std::hash<K>()(key) % n_shards];
+	}
+
+public:
+	lru_cache(const size_t max_size) :
+		max_per_shard(max_size / n_shards > 0 ? max_size / n_shards : 1)
+	{
+		for(size_t i=0; i<n_shards; i++)
+			shards.push_back(new lru_shard_t());
+	}
+
+	lru_cache(const lru_cache &) = delete;
+
+	virtual ~lru_cache() {
+		for(auto s : shards)
+			delete s;
+	}
+
+	std::optional<V> get(const K & key) {
+		lru_shard_t *s = get_shard(key);
+
+		std::unique_lock<std::mutex> lck(s->lock);
+
+		auto it = s->index.find(key);
+
+		if (it == s->index.end())
+			return { };
+
+		s->entries.splice(s->entries.begin(), s->entries, it->second);
+
+		return it->second->second;
+	}
+
+	void put(const K & key, const V & value) {
+		lru_shard_t *s = get_shard(key);
+
+		std::unique_lock<std::mutex> lck(s->lock);
+
+		auto it = s->index.find(key);
+
+		if (it != s->index.end()) {
+			it->second->second = value;
+
+			s->entries.splice(s->entries.begin(), s->entries, it->second);
+
+			return;
+		}
+
+		s->entries.push_front({ key, value });
+
+		s->index.insert({ key, s->entries.begin() });
+
+		if (s->entries.size() > max_per_shard) {
+			s->index.erase(s->entries.back().first);
+
+			s->entries.pop_back();
+		}
+	}
+};
@@ -2,16 +2,54 @@
 #include <string>
 
 #include "base64.h"
+#include "dissect-cache.h"
+#include "dissect-packet.h"
+#include "hashing.h"
 #include "message.h"
+#include "stats.h"
 #include "str.h"
 #include "tranceiver.h"
 
 
+static std::atomic<dissect_cache *> global_dissect_cache { nullptr };
+
+message_meta_state::~message_meta_state()
+{
+	if (dissected == false)
+		stats_inc_counter(cnt_never_dissected);
+
+	delete full;
+}
+
+
 message::message(const timeval & tv, const tranceiver *const source, const uint64_t msg_id, const uint8_t *const data, const size_t size) :
 	tv      (tv),
 	source  (source),
 	msg_id  (msg_id),
-	b       (data, size)
+	b       (data, size),
+	digest  (calc_digest(data, size)),
+	state   (std::make_shared<message_meta_state>())
+{
+}
+
+message::message(const timeval & tv, const tranceiver *const source, const uint64_t msg_id, const buffer & b) :
+	tv      (tv),
+	source  (source),
+	msg_id  (msg_id),
+	b       (b),
+	digest  (calc_digest(b.get_content().first, b.get_content().second)),
+	state   (std::make_shared<message_meta_state>())
+{
+}
+
+// the payload and the meta-data are shared, not copied
+message::message(message && m) :
+	tv      (m.get_tv()),
+	source  (m.get_source()),
+	msg_id  (m.get_msg_id()),
+	b       (m.get_buffer()),
+	digest  (m.get_digest()),
+	state   (std::move(m.state))
 {
 }
 
@@ -19,9 +57,10 @@ message::message(const message & m) :
 	tv      (m.get_tv()),
 	source  (m.get_source()),
 	msg_id  (m.get_msg_id()),
-	b       (m.get_buffer())
+	b       (m.get_buffer()),
+	digest  (m.get_digest()),
+	state   (m.state)
 {
-	set_meta(m.get_meta());
 }
 
 message::~message()
@@ -33,10 +72,75 @@ std::string message::get_id_short() const
 	return myformat("%08lx", msg_id);
 }
 
-void message::set_meta(const std::map<std::string, db_record_data> & meta_in)
+void message::set_meta(const packet_meta & meta_in)
 {
-	for(auto mrec : meta_in)
-		meta[mrec.first] = mrec.second;
+	state->meta.merge(meta_in);
+
+	if (state->full)
+		state->full->merge(meta_in);
+}
+
+void message::set_dissect_cache(dissect_cache *const dc)
+{
+	global_dissect_cache = dc;
+}
+
+void message::dissect() const
+{
+	packet_meta *full = new packet_meta();
+
+	dissect_cache *dc = global_dissect_cache;
+
+	if (dc)
+		*full = dc->dissect(b, digest);
+	else {
+		auto fields = dissect_packet(b.get_pointer(), b.get_size());
+
+		if (fields.has_value()) {
+			full->merge(fields.value().first);
+
+			delete fields.value().second;
+		}
+	}
+
+	// what the receiver set is more specific than what was dissected
+	full->merge(state->meta);
+
+	auto latitude  = full->find(mk_latitude );
+	auto longitude = full->find(mk_longitude);
+	auto gps       = source ? source->get_gps() : nullptr;
+
+	if (latitude && longitude && gps) {
+		std::optional<position_t> position = gps->get_position();
+
+		if (position.has_value()) {
+			double distance = calc_gps_distance(latitude->d_value, longitude->d_value, position.value().latitude, position.value().longitude);
+
+			full->set(mk_distance, db_record_gen(distance));
+		}
+	}
+
+	state->full      = full;
+
+	state->dissected = true;
+}
+
+std::optional<uint32_t> message::get_aprs_digest() const
+{
+	std::call_once(state->aprs_digest_once, [this] {
+		auto content = b.get_content();
+
+		state->aprs_digest = calc_aprs_digest(content.first, content.second);
+	});
+
+	return state->aprs_digest;
+}
+
+const packet_meta & message::get_meta() const
+{
+	std::call_once(state->dissect_once, [this] { dissect(); });
+
+	return *state->full;
 }
 
 std::string message_to_json(const message & m)
@@ -53,32 +157,32 @@ std::string message_to_json(const message & m)
 
 	json_object_set_new(json_out, "msg-id",    json_string(m.get_id_short().c_str()));
 
-	if (meta.find("air-time") != meta.end())
-		json_object_set_new(json_out, "air-time", json_real(meta.at("air-time").d_value));
+	if (auto air_time = meta.find(mk_air_time))
+		json_object_set_new(json_out, "air-time", json_real(air_time->d_value));
 
-	if (meta.find("from") != meta.end())
-		json_object_set_new(json_out, "from", json_string(meta.at("from").s_value.c_str()));
+	if (auto from = meta.find(mk_from))
+		json_object_set_new(json_out, "from", json_string(from->s_value.c_str()));
 
-	if (meta.find("to")   != meta.end())
-		json_object_set_new(json_out, "to",   json_string(meta.at("to"  ).s_value.c_str()));
+	if (auto to = meta.find(mk_to))
+		json_object_set_new(json_out, "to",   json_string(to->s_value.c_str()));
 
-	if (meta.find("latitude")  != meta.end())
-		json_object_set_new(json_out, "latitude",  json_real(meta.at("latitude" ).d_value));
+	if (auto latitude = meta.find(mk_latitude))
+		json_object_set_new(json_out, "latitude",  json_real(latitude->d_value));
 
-	if (meta.find("longitude") != meta.end())
-		json_object_set_new(json_out, "longitude", json_real(meta.at("longitude").d_value));
+	if (auto longitude = meta.find(mk_longitude))
+		json_object_set_new(json_out, "longitude", json_real(longitude->d_value));
 
-	if (meta.find("protocol")  != meta.end())
-		json_object_set_new(json_out, "protocol",  json_string(meta.at("protocol").s_value.c_str()));
+	if (auto protocol = meta.find(mk_protocol))
+		json_object_set_new(json_out, "protocol",  json_string(protocol->s_value.c_str()));
 
-	if (meta.find("payload")   != meta.end())
-		json_object_set_new(json_out, "payload",   json_string(meta.at("payload").s_value.c_str()));
+	if (auto payload = meta.find(mk_payload))
+		json_object_set_new(json_out, "payload",   json_string(payload->s_value.c_str()));
 
-	if (meta.find("pkt-crc")   != meta.end())
-		json_object_set_new(json_out, "pkt-crc",   json_string(meta.at("pkt-crc").s_value.c_str()));
+	if (auto pkt_crc = meta.find(mk_pkt_crc))
+		json_object_set_new(json_out, "pkt-crc",   json_string(pkt_crc->s_value.c_str()));
 
-	if (meta.find("rssi")      != meta.end())
-		json_object_set_new(json_out, "rssi",      json_string(meta.at("rssi").s_value.c_str()));
+	if (auto rssi = meta.find(mk_rssi))
+		json_object_set_new(json_out, "rssi",      json_string(rssi->s_value.c_str()));
 
 	auto content = m.get_content();
 
@@ -97,8 +201,9 @@ std::string message_to_json(const message & m)
 	return json_out_str;
 }
 
-void dump_meta(const std::map<std::string, db_record_data> & meta)
+void dump_meta(const packet_meta & meta)
 {
-	for(auto & entry : meta)
-		printf("%s:\t%s\n", entry.first.c_str(), entry.second.s_value.c_str());
+	meta.for_each([](const std::string & name, const db_record_data & value) {
+		printf("%s:\t%s\n", name.c_str(), value.s_value.c_str());
+	});
 }
@@ -1,16 +1,40 @@
 #pragma once
 
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdlib.h>
 #include <string>
 #include <sys/time.h>
 
 #include "buffer.h"
 #include "db-common.h"
+#include "packet-meta.h"
 
 
+class dissect_cache;
 class tranceiver;
 
+// shared by all copies of a message
+struct message_meta_state
+{
+	packet_meta      meta;       // set by the receiver (e.g. "pkt-crc", "rssi")
+
+	std::once_flag   dissect_once;
+	std::atomic_bool dissected   { false   };
+	packet_meta     *full        { nullptr };  // meta + dissected fields
+
+	std::once_flag   aprs_digest_once;
+	std::optional<uint32_t> aprs_digest;  // see calc_aprs_digest()
+
+	// incremented when the message is freed without having been dissected
+	uint64_t        *cnt_never_dissected { nullptr };
+
+	~message_meta_state();
+};
+
 class message {
 private:
 	const timeval     tv     { 0, 0    };
@@ -21,13 +45,21 @@ private:
 
 	const buffer      b;
 
-	std::map<std::string, db_record_data> meta;
+	const uint32_t    digest { 0       };  // of the content
+
+	std::shared_ptr<message_meta_state> state;
+
+	void           dissect() const;
 
 public:
 	message(const timeval & tv, const tranceiver *const source, const uint64_t msg_id, const uint8_t *const data, const size_t size);
 
+	message(const timeval & tv, const tranceiver *const source, const uint64_t msg_id, const buffer & b);
+
 	message(const message & m);
 
+	message(message && m);
+
 	virtual ~message();
 
 	timeval        get_tv()         const { return tv;       }
@@ -40,13 +72,30 @@ public:
 
 	auto           get_content()    const { return b.get_content(); }
 
+	uint32_t       get_digest()     const { return digest;   }
+
+	// calc_aprs_digest() of the content, determined on first use
+	std::optional<uint32_t> get_aprs_digest() const;
+
 	std::string    get_id_short()   const;
 
-	void           set_meta(const std::map<std::string, db_record_data> & meta);
+	// only while the message is not yet shared with other threads
+	void           set_meta(const packet_meta & meta);
+
+	// dissects the packet on first use
+	const packet_meta & get_meta()  const;
+
+	// only the fields set via set_meta(); does not dissect
+	const packet_meta & get_meta_undissected() const { return state->meta; }
+
+	bool           is_dissected()   const { return state->dissected; }
+
+	void           set_never_dissected_counter(uint64_t *const counter) const { state->cnt_never_dissected = counter; }
 
-	auto         & get_meta()       const { return meta;    }
+	// used by all messages (if set)
+	static void    set_dissect_cache(dissect_cache *const dc);
 };
 
 std::string message_to_json(const message & m);
 
-void dump_meta(const std::map<std::string, db_record_data> & meta);
+void dump_meta(const packet_meta & meta);
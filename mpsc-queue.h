@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <linux/futex.h>
+#include <optional>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+// Bounded lock-free multi-producer/single-consumer queue (after the
+// array based queue by Dmitry Vyukov). Each slot carries a sequence
+// number that tells whether it can be written or read. A consumer
+// without work sleeps on a futex; producers only do a syscall when
+// the consumer is actually sleeping.
+template <typename T>
+class mpsc_queue
+{
+private:
+	struct slot {
+		std::atomic_size_t seq { 0 };
+		T                  data;
+	};
+
+	const size_t size { 0       };
+	const size_t mask { 0       };
+	slot  *const slots{ nullptr };
+
+	alignas(64) std::atomic_size_t   head      { 0 };  // producers
+	alignas(64) size_t               tail      { 0 };  // consumer
+	alignas(64) std::atomic_uint32_t futex     { 0 };
+	            std::atomic_uint32_t n_waiting { 0 };
+
+	static size_t round_up(const size_t n) {
+		size_t out = 2;
+
+		while(out < n)
+			out <<= 1;
+
+		return out;
+	}
+
+	void wake_consumer() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (n_waiting.load(std::memory_order_relaxed)) {
+			futex.fetch_add(1, std::memory_order_seq_cst);
+
+			syscall(SYS_futex, reinterpret_cast<uint32_t *>(&futex), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+		}
+	}
+
+public:
+	mpsc_queue(const size_t size_in) :
+		size(round_up(size_in)),
+		mask(size - 1),
+		slots(new slot[size])
+	{
+		for(size_t i=0; i<size; i++)
+			slots[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	virtual ~mpsc_queue() {
+		delete [] slots;
+	}
+
+	// returns false when the queue is full
+	bool push(const T & v) {
+		size_t pos  = head.load(std::memory_order_relaxed);
+		slot  *s    = nullptr;
+
+		for(;;) {
+			s = &slots[pos & mask];
+
+			size_t   seq = s->seq.load(std::memory_order_acquire);
+			intptr_t dif = intptr_t(seq) - intptr_t(pos);
+
+			if (dif == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (dif < 0) {
+				return false;
+			}
+			else {
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+
+		s->data = v;
+		s->seq.store(pos + 1, std::memory_order_release);
+
+		wake_consumer();
+
+		return true;
+	}
+
+	// may only be called by the (single) consumer
+	std::optional<T> try_pop() {
+		slot  *s   = &slots[tail & mask];
+
+		size_t seq = s->seq.load(std::memory_order_acquire);
+
+		if (seq != tail + 1)
+			return { };  // empty (or a producer did not finish yet)
+
+		T v = s->data;
+
+		s->seq.store(tail + size, std::memory_order_release);
+
+		tail++;
+
+		return v;
+	}
+
+	// waits at most timeout_ms for an element
+	std::optional<T> pop(const int timeout_ms) {
+		auto v = try_pop();
+
+		if (v.has_value())
+			return v;
+
+		uint32_t futex_value = futex.load(std::memory_order_seq_cst);
+
+		n_waiting.fetch_add(1, std::memory_order_seq_cst);
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		v = try_pop();
+
+		if (v.has_value() == false) {
+			timespec ts { timeout_ms / 1000, (timeout_ms % 1000) * 1000000l };
+
+			syscall(SYS_futex, reinterpret_cast<uint32_t *>(&futex), FUTEX_WAIT_PRIVATE, futex_value, &ts, nullptr, 0);
+
+			v = try_pop();
+		}
+
+		n_waiting.fetch_sub(1, std::memory_order_seq_cst);
+
+		return v;
+	}
+
+	// e.g. to let the consumer know it should terminate
+	void wake() {
+		futex.fetch_add(1, std::memory_order_seq_cst);
+
+		syscall(SYS_futex, reinterpret_cast<uint32_t *>(&futex), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+	}
+};
@@ -14,6 +14,7 @@
 #include "error.h"
 #include "log.h"
 #include "net.h"
+#include "str.h"
 
 void set_nodelay(int fd)
 {
@@ -80,20 +81,12 @@ int connect_to(const char *host, const int portnr)
         return -1;
 }
 
-bool transmit_udp(const std::string & dest, const uint8_t *const data, const size_t data_len)
+// "dest" is host:port; the first address of "family" is returned
+bool resolve_udp(const std::string & dest, const int family, sockaddr_storage *const addr, socklen_t *const addr_len)
 {
-        struct addrinfo hints { 0 };
-        hints.ai_family    = AF_UNSPEC;    // Allow IPv4 or IPv6
-        hints.ai_socktype  = SOCK_DGRAM;
-        hints.ai_flags     = AI_PASSIVE;    // For wildcard IP address
-        hints.ai_protocol  = 0;          // Any protocol
-        hints.ai_canonname = nullptr;
-        hints.ai_addr      = nullptr;
-        hints.ai_next      = nullptr;
-
-	std::size_t colon = dest.find(":");
+	std::size_t colon = dest.rfind(":");
 	if (colon == std::string::npos) {
-                log(LL_ERROR, "Port number missing (%s)", dest.c_str());
+		log(LL_ERROR, "Port number missing (%s)", dest.c_str());
 
 		return false;
 	}
@@ -102,32 +95,75 @@ bool transmit_udp(const std::string & dest, const uint8_t *const data, const siz
 
 	std::string host   = dest.substr(0, colon);
 
-        struct addrinfo *result = nullptr;
-        int rc = getaddrinfo(host.c_str(), portnr.c_str(), &hints, &result);
-        if (rc != 0) {
-                log(LL_WARNING, "Problem resolving %s: %s", host.c_str(), gai_strerror(rc));
+	// [ipv6-address]:port
+	if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+		host = host.substr(1, host.size() - 2);
+
+	struct addrinfo hints { 0 };
+	hints.ai_family    = family;
+	hints.ai_socktype  = SOCK_DGRAM;
+
+	struct addrinfo *result = nullptr;
+	int rc = getaddrinfo(host.c_str(), portnr.c_str(), &hints, &result);
+	if (rc != 0) {
+		log(LL_WARNING, "Problem resolving %s: %s", host.c_str(), gai_strerror(rc));
 
 		return false;
 	}
 
-	bool ok = true;
+	memcpy(addr, result->ai_addr, result->ai_addrlen);
 
-        for(struct addrinfo *rp = result; rp != nullptr; rp = rp->ai_next) {
-                int fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-                if (fd == -1)
-                        continue;
+	*addr_len = result->ai_addrlen;
 
-		if (sendto(fd, data, data_len, 0, rp->ai_addr, rp->ai_addrlen) != ssize_t(data_len))
-			ok = false;
+	freeaddrinfo(result);
 
-		close(fd);
+	return true;
+}
 
-		break;
-        }
+// same address and port (ipv4/ipv6)
+bool sockaddr_equal(const sockaddr *const a, const sockaddr *const b)
+{
+	if (a->sa_family != b->sa_family)
+		return false;
 
-        freeaddrinfo(result);
+	if (a->sa_family == AF_INET) {
+		auto a4 = reinterpret_cast<const sockaddr_in *>(a);
+		auto b4 = reinterpret_cast<const sockaddr_in *>(b);
+
+		return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+	}
+
+	if (a->sa_family == AF_INET6) {
+		auto a6 = reinterpret_cast<const sockaddr_in6 *>(a);
+		auto b6 = reinterpret_cast<const sockaddr_in6 *>(b);
+
+		return a6->sin6_port == b6->sin6_port && memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof a6->sin6_addr) == 0;
+	}
+
+	return false;
+}
+
+std::string sockaddr_to_str(const sockaddr *const a)
+{
+	char buffer[INET6_ADDRSTRLEN] { 0 };
+
+	if (a->sa_family == AF_INET) {
+		auto a4 = reinterpret_cast<const sockaddr_in *>(a);
+
+		inet_ntop(AF_INET, &a4->sin_addr, buffer, sizeof buffer);
+
+		return myformat("%s:%d", buffer, ntohs(a4->sin_port));
+	}
+
+	if (a->sa_family == AF_INET6) {
+		auto a6 = reinterpret_cast<const sockaddr_in6 *>(a);
+
+		inet_ntop(AF_INET6, &a6->sin6_addr, buffer, sizeof buffer);
+
+		return myformat("[%s]:%d", buffer, ntohs(a6->sin6_port));
+	}
 
-	return ok;
+	return "?";
 }
 
 void startiface(const char *const dev)
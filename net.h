@@ -1,10 +1,13 @@
 #include <stdint.h>
 #include <string>
+#include <sys/socket.h>
 
 #define MAX_PACKET_SIZE 254
 
 int  connect_to(const char *host, const int portnr);
-bool transmit_udp(const std::string & dest, const uint8_t *const data, const size_t data_len);
+bool resolve_udp(const std::string & dest, const int family, sockaddr_storage *const addr, socklen_t *const addr_len);
+bool sockaddr_equal(const sockaddr *const a, const sockaddr *const b);
+std::string sockaddr_to_str(const sockaddr *const a);
 int  WRITE(int fd, const uint8_t *whereto, size_t len);
 
 void startiface(const char *const dev);
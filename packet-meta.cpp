@@ -0,0 +1,76 @@
+#include <string.h>
+
+#include "packet-meta.h"
+
+
+static const char *const fixed_names[mk_n_fixed] = { "from", "to", "protocol", "latitude", "longitude", "rssi", "air-time", "pkt-crc", "distance", "payload" };
+
+int packet_meta_key(const std::string & name)
+{
+	for(int i=0; i<mk_n_fixed; i++) {
+		if (strcmp(fixed_names[i], name.c_str()) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+const char *packet_meta_key_name(const int key)
+{
+	return fixed_names[key];
+}
+
+packet_meta::packet_meta()
+{
+}
+
+packet_meta::~packet_meta()
+{
+}
+
+const db_record_data * packet_meta::find(const std::string & name) const
+{
+	int key = packet_meta_key(name);
+
+	if (key != -1)
+		return find(key);
+
+	for(auto & entry : overflow) {
+		if (entry.first == name)
+			return &entry.second;
+	}
+
+	return nullptr;
+}
+
+void packet_meta::set(const std::string & name, const db_record_data & value)
+{
+	int key = packet_meta_key(name);
+
+	if (key != -1) {
+		set(key, value);
+
+		return;
+	}
+
+	for(auto & entry : overflow) {
+		if (entry.first == name) {
+			entry.second = value;
+
+			return;
+		}
+	}
+
+	overflow.push_back({ name, value });
+}
+
+void packet_meta::merge(const packet_meta & other)
+{
+	for(int i=0; i<mk_n_fixed; i++) {
+		if (other.present & (1 << i))
+			set(i, other.fixed[i]);
+	}
+
+	for(auto & entry : other.overflow)
+		set(entry.first, entry.second);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "db-common.h"
+
+
+// fields that (almost) every packet has get a fixed slot
+typedef enum { mk_from, mk_to, mk_protocol, mk_latitude, mk_longitude, mk_rssi, mk_air_time, mk_pkt_crc, mk_distance, mk_payload, mk_n_fixed } packet_meta_key_t;
+
+// returns -1 for a field without a fixed slot
+int packet_meta_key(const std::string & name);
+
+const char *packet_meta_key_name(const int key);
+
+// Meta-data of a packet. Well-known fields are stored in fixed slots
+// (no lookup by string, no allocation per field), rare fields in a
+// small overflow list.
+class packet_meta
+{
+private:
+	uint32_t                                             present  { 0 };
+	std::array<db_record_data, mk_n_fixed>               fixed;
+	std::vector<std::pair<std::string, db_record_data> > overflow;
+
+public:
+	packet_meta();
+	virtual ~packet_meta();
+
+	const db_record_data * find(const int key) const {
+		return (present & (1 << key)) ? &fixed[key] : nullptr;
+	}
+
+	const db_record_data * find(const std::string & name) const;
+
+	void set(const int key, const db_record_data & value) {
+		fixed[key] = value;
+
+		present   |= 1 << key;
+	}
+
+	void set(const std::string & name, const db_record_data & value);
+
+	// fields in "other" overwrite the ones in this object
+	void merge(const packet_meta & other);
+
+	bool empty() const { return present == 0 && overflow.empty(); }
+
+	template <typename F>
+	void for_each(F && f) const {
+		for(int i=0; i<mk_n_fixed; i++) {
+			if (present & (1 << i))
+				f(std::string(packet_meta_key_name(i)), fixed[i]);
+		}
+
+		for(auto & entry : overflow)
+			f(entry.first, entry.second);
+	}
+};
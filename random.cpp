@@ -2,8 +2,10 @@
 #include <stdint.h>
 #include <sys/random.h>
 
+#include "random.h"
 
-uint64_t get_random_uint64_t()
+
+uint64_t get_random_uint64_t_syscall()
 {
 	uint64_t out { 0 };
 
@@ -13,3 +15,51 @@ uint64_t get_random_uint64_t()
 
 	return out;
 }
+
+typedef struct {
+	uint64_t s[4];
+	bool     seeded;
+} xoshiro_state_t;
+
+static thread_local xoshiro_state_t xoshiro_state { { 0, 0, 0, 0 }, false };
+
+static inline uint64_t rotl(const uint64_t x, const int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256** by David Blackman and Sebastiano Vigna (public domain)
+uint64_t get_random_uint64_t()
+{
+	xoshiro_state_t & st = xoshiro_state;
+
+	if (st.seeded == false) {
+		// 256 random bits per thread: sequences of different threads
+		// (and runs) do not overlap in practice
+		do {
+			ssize_t rc = getrandom(st.s, sizeof st.s, 0);
+
+			assert(rc == sizeof st.s);
+		}
+		while((st.s[0] | st.s[1] | st.s[2] | st.s[3]) == 0);
+
+		st.seeded = true;
+	}
+
+	uint64_t *s      = st.s;
+
+	uint64_t  result = rotl(s[1] * 5, 7) * 9;
+
+	uint64_t  t      = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+
+	s[2] ^= t;
+
+	s[3]  = rotl(s[3], 45);
+
+	return result;
+}
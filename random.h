@@ -1,3 +1,8 @@
 #include <stdint.h>
 
+// not cryptographically secure: a per-thread xoshiro256** generator,
+// seeded from getrandom() once per thread (e.g. for message ids)
 uint64_t get_random_uint64_t();
+
+// one getrandom() call per invocation
+uint64_t get_random_uint64_t_syscall();
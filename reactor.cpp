@@ -0,0 +1,203 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "error.h"
+#include "log.h"
+#include "reactor.h"
+#include "str.h"
+#include "utils.h"
+
+
+reactor::reactor(const int n_threads, const bool use_io_uring)
+{
+	if (use_io_uring) {
+		// large enough for an axudp datagram plus its sender address
+		u = io_uring_backend::create(256, 2048);
+
+		if (!u)
+			log(LL_WARNING, "reactor: io_uring not available, using epoll");
+	}
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1)
+		error_exit(true, "reactor: epoll_create1 failed");
+
+	stop_fd  = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (stop_fd == -1)
+		error_exit(true, "reactor: eventfd failed");
+
+	// level triggered and never read: wakes up all workers
+	epoll_event ev { 0 };
+	ev.events  = EPOLLIN;
+	ev.data.fd = stop_fd;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev) == -1)
+		error_exit(true, "reactor: epoll_ctl failed");
+
+	for(int i=0; i<n_threads; i++)
+		workers.push_back(new std::thread(&reactor::worker, this, i));
+
+	log(LL_INFO, "Started %d reactor thread(s)", n_threads);
+}
+
+reactor::~reactor()
+{
+	stop();
+
+	for(auto & entry : entries)
+		delete entry.second;
+
+	delete u;
+
+	close(stop_fd);
+
+	close(epoll_fd);
+}
+
+void reactor::stop()
+{
+	uint64_t v = 1;
+
+	if (write(stop_fd, &v, sizeof v) != sizeof v)
+		log(LL_ERROR, "reactor: cannot signal stop: %s", strerror(errno));
+
+	for(auto th : workers) {
+		th->join();
+
+		delete th;
+	}
+
+	workers.clear();
+
+	if (u)
+		u->stop();
+}
+
+void reactor::add(const int fd, const reactor_callback_t & cb)
+{
+	std::unique_lock<std::mutex> lck(lock);
+
+	entries.insert({ fd, new reactor_entry_t { cb, false } });
+
+	// one-shot: re-armed after the callback returned, so that only one
+	// worker handles a file descriptor at a time
+	epoll_event ev { 0 };
+	ev.events  = EPOLLIN | EPOLLONESHOT;
+	ev.data.fd = fd;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+		error_exit(true, "reactor: cannot add fd %d", fd);
+}
+
+void reactor::add(const int fd, const reactor_callback_t & cb, const io_uring_callback_t & data_cb)
+{
+	if (u)
+		u->add(fd, data_cb);
+	else
+		add(fd, cb);
+}
+
+void reactor::remove(const int fd)
+{
+	if (u)
+		u->remove(fd);
+
+	std::unique_lock<std::mutex> lck(lock);
+
+	auto it = entries.find(fd);
+
+	if (it == entries.end())
+		return;
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+	reactor_entry_t *entry = it->second;
+
+	entries.erase(it);
+
+	while(entry->busy)
+		cv.wait(lck);
+
+	delete entry;
+}
+
+bool reactor::rearm(const int fd)
+{
+	epoll_event ev { 0 };
+	ev.events  = EPOLLIN | EPOLLONESHOT;
+	ev.data.fd = fd;
+
+	return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void reactor::worker(const size_t nr)
+{
+	set_thread_name(myformat("reactor-%zu", nr));
+
+	for(;;) {
+		epoll_event ev { 0 };
+
+		int rc = epoll_wait(epoll_fd, &ev, 1, -1);
+
+		if (rc == -1) {
+			if (errno == EINTR)
+				continue;
+
+			log(LL_ERROR, "reactor: epoll_wait failed: %s", strerror(errno));
+
+			break;
+		}
+
+		if (rc == 0)
+			continue;
+
+		int fd = ev.data.fd;
+
+		if (fd == stop_fd)
+			break;
+
+		std::unique_lock<std::mutex> lck(lock);
+
+		auto it = entries.find(fd);
+
+		if (it == entries.end())  // removed meanwhile
+			continue;
+
+		reactor_entry_t *entry = it->second;
+
+		entry->busy = true;
+
+		lck.unlock();
+
+		bool keep = false;
+
+		try {
+			keep = entry->cb();
+		}
+		catch(const std::exception & e) {
+			log(LL_ERROR, "reactor: exception in callback for fd %d: %s", fd, e.what());
+
+			keep = true;
+		}
+
+		lck.lock();
+
+		entry->busy = false;
+
+		// still registered (and not replaced)?
+		it = entries.find(fd);
+
+		if (it != entries.end() && it->second == entry) {
+			if (keep == false || rearm(fd) == false) {
+				epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+				log(LL_WARNING, "reactor: no longer watching fd %d", fd);
+			}
+		}
+
+		cv.notify_all();
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io-uring.h"
+
+
+// return false to no longer watch the file descriptor (e.g. on an error)
+typedef std::function<bool()> reactor_callback_t;
+
+typedef struct {
+	reactor_callback_t cb;
+	bool               busy;
+} reactor_entry_t;
+
+// Event loop (epoll) for all file descriptor based inputs (tranceivers,
+// snmp). A callback is invoked from a small thread pool when its file
+// descriptor is readable, never by two threads at the same time. No
+// periodic wakeups: stopping is signalled via an eventfd.
+// Optionally the kiss and axudp inputs use io_uring instead.
+class reactor
+{
+private:
+	int                        epoll_fd { -1 };
+	int                        stop_fd  { -1 };  // eventfd
+
+	std::mutex                 lock;
+	std::condition_variable    cv;  // an entry is no longer busy
+	std::map<int, reactor_entry_t *> entries;
+
+	std::vector<std::thread *> workers;
+
+	io_uring_backend          *u        { nullptr };
+
+	void worker(const size_t nr);
+	bool rearm(const int fd);
+
+public:
+	reactor(const int n_threads, const bool use_io_uring);
+	reactor(const reactor &) = delete;
+	virtual ~reactor();
+
+	void stop();
+
+	void add(const int fd, const reactor_callback_t & cb);
+	// via io_uring when that is in use (data_cb then gets what was
+	// received), else as above (cb reads by itself)
+	void add(const int fd, const reactor_callback_t & cb, const io_uring_callback_t & data_cb);
+
+	// waits for a running callback of fd to finish
+	void remove(const int fd);
+
+	// nullptr: not in use
+	io_uring_backend * get_io_uring() const { return u; }
+};
@@ -0,0 +1,161 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "error.h"
+#include "log.h"
+#include "seen-shm.h"
+
+
+// slot: hash (32 bits) | time (24 bits, in 100 ms units, wraps after
+// ~19 days) | tokens (8 bits, in 1/8th), 0: not used
+static constexpr int      n_ways       { 8      };
+static constexpr uint64_t time_unit_us { 100000 };
+static constexpr uint64_t time_mask    { (1 << 24) - 1 };
+static constexpr uint64_t token_unit   { 8      };
+
+static uint64_t pack_slot(const uint32_t hash, const uint64_t t, const uint64_t tokens)
+{
+	return (uint64_t(hash) << 32) | ((t & time_mask) << 8) | tokens;
+}
+
+seen_shm::seen_shm(const std::string & name, const int max_per_dt, const double dt, const size_t max_n) :
+	name(name),
+	max_per_dt(max_per_dt),
+	dt_us(uint64_t(dt * 1000000))
+{
+	if (max_per_dt < 1 || uint64_t(max_per_dt) * token_unit > 255)
+		error_exit(false, "seen: max-per-interval must be between 1 and %d for a shared memory table", int(255 / token_unit));
+
+	if (dt_us / time_unit_us >= time_mask)
+		error_exit(false, "seen: interval-duration too large for a shared memory table");
+
+	n_sets = 1;
+
+	while(n_sets * n_ways < max_n)
+		n_sets <<= 1;
+
+	size   = (1 + n_sets * n_ways) * sizeof(uint64_t);
+
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd == -1)
+		error_exit(true, "seen: shm_open(%s)", name.c_str());
+
+	struct stat st { 0 };
+
+	if (fstat(fd, &st) == -1)
+		error_exit(true, "seen: fstat(%s)", name.c_str());
+
+	// zero-filled: an empty table
+	if (st.st_size == 0 && ftruncate(fd, size) == -1)
+		error_exit(true, "seen: truncate(%s)", name.c_str());
+
+	if (fstat(fd, &st) == -1 || size_t(st.st_size) != size)
+		error_exit(false, "seen: shared memory \"%s\" exists with a different max-n-elements", name.c_str());
+
+	void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		error_exit(true, "seen: mmap(%s)", name.c_str());
+
+	close(fd);
+
+	header = reinterpret_cast<std::atomic_uint64_t *>(p);
+	slots  = header + 1;
+
+	// the first process to attach claims it with its settings; the
+	// others must use the same ones
+	uint64_t settings = (uint64_t(0x5345454e) << 32) ^ (dt_us << 8) ^ uint64_t(max_per_dt);
+	uint64_t expected = 0;
+
+	if (header->compare_exchange_strong(expected, settings) == false && expected != settings)
+		error_exit(false, "seen: shared memory \"%s\" is in use with a different max-per-interval and/or interval-duration", name.c_str());
+
+	log(LL_INFO, "seen: attached to shared memory \"%s\" (%zu entries)", name.c_str(), n_sets * n_ways);
+}
+
+seen_shm::~seen_shm()
+{
+	// not unlinked: other processes may still use it
+	munmap(header, size);
+}
+
+bool seen_shm::check(uint32_t hash, const uint64_t now_us)
+{
+	if (hash == 0)  // 0 is a free slot
+		hash = 1;
+
+	const uint64_t now        = now_us / time_unit_us;
+	const uint64_t dt_units   = dt_us / time_unit_us;
+	const uint64_t max_tokens = max_per_dt * token_unit;
+
+	std::atomic_uint64_t *set = &slots[(hash & (n_sets - 1)) * n_ways];
+
+	for(;;) {
+		std::atomic_uint64_t *victim      = nullptr;
+		uint64_t              victim_word = 0;
+		uint64_t              victim_age  = 0;
+
+		for(int i=0; i<n_ways; i++) {
+			uint64_t word = set[i].load(std::memory_order_acquire);
+
+			uint64_t age  = (now - (word >> 8)) & time_mask;
+
+			// stored by someone whose clock was a bit ahead (or the
+			// clock went back): not in the past, so no refill and no
+			// eviction because of the wrapped difference
+			if (age > time_mask / 2)
+				age = 0;
+
+			if (word != 0 && uint32_t(word >> 32) == hash) {
+				uint64_t tokens = word & 0xff;
+				uint64_t t      = (word >> 8) & time_mask;
+
+				if (age >= dt_units) {
+					tokens = max_tokens;
+					t      = now;
+				}
+				else if (dt_units > 0) {
+					uint64_t add = age * max_tokens / dt_units;
+
+					// only move the clock by the time the tokens represent
+					if (add) {
+						tokens += add;
+						t      += add * dt_units / max_tokens;
+					}
+
+					if (tokens >= max_tokens) {
+						tokens = max_tokens;
+						t      = now;
+					}
+				}
+
+				bool allow = tokens >= token_unit;
+
+				if (allow)
+					tokens -= token_unit;
+
+				if (set[i].compare_exchange_strong(word, pack_slot(hash, t, tokens), std::memory_order_acq_rel))
+					return allow;
+
+				// changed by someone else meanwhile
+				victim = nullptr;
+
+				break;
+			}
+
+			// free or expired slots first, else the one idle the longest
+			if (word == 0)
+				age = time_mask + 1;
+
+			if (victim == nullptr || age > victim_age) {
+				victim      = &set[i];
+				victim_word = word;
+				victim_age  = age;
+			}
+		}
+
+		if (victim && victim->compare_exchange_strong(victim_word, pack_slot(hash, now, max_tokens - token_unit), std::memory_order_acq_rel))
+			return true;
+	}
+}
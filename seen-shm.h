@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+
+// Duplicate table in POSIX shared memory, so that several ham-router
+// processes on one host can share it: each process attaches to it by
+// name. Sets of 8 slots (one cache line); each slot is a single 64 bit
+// word (hash, time, tokens) that is updated with compare-and-swap, so
+// no locks are needed between processes.
+class seen_shm
+{
+private:
+	const std::string name;
+	const int         max_per_dt { 0 };
+	const uint64_t    dt_us      { 0 };
+
+	std::atomic_uint64_t *header { nullptr };
+	std::atomic_uint64_t *slots  { nullptr };
+	size_t                n_sets { 0       };
+	size_t                size   { 0       };
+
+public:
+	seen_shm(const std::string & name, const int max_per_dt, const double dt, const size_t max_n);
+	virtual ~seen_shm();
+
+	// true: not (too often) seen before
+	bool check(const uint32_t hash, const uint64_t now_us);
+};
@@ -0,0 +1,241 @@
+#include <algorithm>
+
+#include "seen-table.h"
+
+
+static constexpr size_t   n_wheel_slots  { 128 };  // power of 2
+static constexpr uint64_t ticks_per_dt   { 64  };  // must be < n_wheel_slots
+
+seen_table::seen_table(const int max_per_dt, const double dt, const size_t max_n, seen_entry_t *const storage) :
+	max_per_dt(max_per_dt),
+	dt_us(uint64_t(dt * 1000000)),
+	max_n(max_n > 0 ? max_n : 1)
+{
+	size_t n = capacity(this->max_n);
+
+	if (storage)
+		table = storage;
+	else {
+		own_table.resize(n);
+
+		table = own_table.data();
+	}
+
+	mask    = n - 1;
+
+	wheel.resize(n_wheel_slots);
+
+	tick_us = dt_us / ticks_per_dt > 0 ? dt_us / ticks_per_dt : 1;
+}
+
+seen_table::~seen_table()
+{
+}
+
+size_t seen_table::capacity(const size_t max_n)
+{
+	size_t n = 16;
+
+	while(n < max_n * 2)
+		n <<= 1;
+
+	return n;
+}
+
+void seen_table::restore(const uint64_t now_us)
+{
+	std::vector<seen_entry_t> keep;
+
+	for(size_t i=0; i<=mask; i++) {
+		if (table[i].used && table[i].last_us + dt_us > now_us && table[i].last_us <= now_us)
+			keep.push_back(table[i]);
+
+		table[i].used = false;
+	}
+
+	// newest first so that those survive when max_n became smaller
+	std::sort(keep.begin(), keep.end(), [](const seen_entry_t & a, const seen_entry_t & b) { return a.last_us > b.last_us; });
+
+	if (keep.size() > max_n)
+		keep.resize(max_n);
+
+	for(auto & slot : wheel)
+		slot.clear();
+
+	n_used   = 0;
+
+	cur_tick = 0;
+
+	advance(now_us);
+
+	for(auto & e : keep) {
+		size_t index = find_slot(e.hash);
+
+		table[index] = e;
+
+		n_used++;
+
+		schedule(e.hash, e.last_us);
+	}
+}
+
+size_t seen_table::find_slot(const uint32_t hash) const
+{
+	size_t index = hash & mask;  // crc32: the lower bits are fine
+
+	while(table[index].used && table[index].hash != hash)
+		index = (index + 1) & mask;
+
+	return index;
+}
+
+// backward-shift deletion: no tombstones, so lookups stay short
+void seen_table::erase_at(size_t index)
+{
+	size_t next = index;
+
+	for(;;) {
+		next = (next + 1) & mask;
+
+		if (table[next].used == false)
+			break;
+
+		size_t home = table[next].hash & mask;
+
+		// can the entry at "next" stay where it is?
+		bool   stay = index <= next ? (index < home && home <= next) : (index < home || home <= next);
+
+		if (stay)
+			continue;
+
+		table[index] = table[next];
+
+		index        = next;
+	}
+
+	table[index].used = false;
+
+	n_used--;
+}
+
+void seen_table::schedule(const uint32_t hash, const uint64_t last_us)
+{
+	uint64_t expire_tick = (last_us + dt_us + tick_us - 1) / tick_us;
+
+	wheel[expire_tick & (n_wheel_slots - 1)].push_back(hash);
+}
+
+void seen_table::advance(const uint64_t now_us)
+{
+	uint64_t target_tick = now_us / tick_us;
+
+	if (cur_tick == 0)
+		cur_tick = target_tick;
+
+	// not called for longer than the wheel spans: everything expired
+	if (target_tick >= cur_tick + n_wheel_slots) {
+		for(size_t i=0; i<=mask; i++)
+			table[i].used = false;
+
+		for(auto & slot : wheel)
+			slot.clear();
+
+		n_used   = 0;
+
+		cur_tick = target_tick;
+	}
+
+	while(cur_tick <= target_tick) {
+		std::deque<uint32_t> slot;
+
+		slot.swap(wheel[cur_tick & (n_wheel_slots - 1)]);
+
+		for(auto hash : slot) {
+			size_t index = find_slot(hash);
+
+			if (table[index].used == false)  // evicted earlier
+				continue;
+
+			if (table[index].last_us + dt_us <= now_us)
+				erase_at(index);
+			else
+				schedule(hash, table[index].last_us);
+		}
+
+		// keep the allocated memory of the slot
+		slot.clear();
+
+		if (wheel[cur_tick & (n_wheel_slots - 1)].empty())
+			wheel[cur_tick & (n_wheel_slots - 1)].swap(slot);
+
+		cur_tick++;
+	}
+}
+
+// table is full: drop the entry that is scheduled to expire first
+void seen_table::evict_one()
+{
+	for(size_t i=0; i<n_wheel_slots; i++) {
+		auto & slot = wheel[(cur_tick + i) & (n_wheel_slots - 1)];
+
+		while(slot.empty() == false) {
+			uint32_t hash  = slot.front();  // oldest first
+
+			slot.pop_front();
+
+			size_t   index = find_slot(hash);
+
+			if (table[index].used) {
+				erase_at(index);
+
+				return;
+			}
+		}
+	}
+}
+
+bool seen_table::check(const uint32_t hash, const uint64_t now_us)
+{
+	advance(now_us);
+
+	size_t index = find_slot(hash);
+
+	if (table[index].used == false) {
+		if (n_used >= max_n) {
+			evict_one();
+
+			index = find_slot(hash);
+		}
+
+		seen_entry_t & e = table[index];
+
+		e.hash      = hash;
+		e.used      = true;
+		e.allowance = max_per_dt;  // a new bucket is full
+		e.last_us   = now_us;
+
+		n_used++;
+
+		schedule(hash, now_us);
+	}
+	else {
+		seen_entry_t & e = table[index];
+
+		if (dt_us > 0 && now_us > e.last_us)
+			e.allowance += (now_us - e.last_us) * double(max_per_dt) / dt_us;
+
+		if (e.allowance > max_per_dt)
+			e.allowance = max_per_dt;  // throttle
+
+		e.last_us = now_us;
+	}
+
+	seen_entry_t & e = table[index];
+
+	if (e.allowance < 1.0)
+		return false;
+
+	e.allowance -= 1.0;
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+typedef struct {
+	uint32_t hash;
+	bool     used;
+	float    allowance;  // token bucket, unit: messages
+	uint64_t last_us;
+} seen_entry_t;
+
+// Open-addressing hash table (linear probing, backward-shift deletion)
+// of token buckets. Entries expire via a timing wheel: an entry that was
+// not seen for "dt" seconds has a full bucket again, so it is removed
+// instead of kept around. All work is amortised O(1) per check(); the
+// caller does the locking.
+class seen_table
+{
+private:
+	const int      max_per_dt { 0 };
+	const uint64_t dt_us      { 0 };
+	const size_t   max_n      { 0 };
+
+	std::vector<seen_entry_t> own_table;
+	seen_entry_t             *table   { nullptr };  // own_table or e.g. a memory mapped file
+	size_t                    mask    { 0 };
+	size_t                    n_used  { 0 };
+
+	// each used entry is in exactly one slot: the one of its (earliest)
+	// expiry; it is rescheduled when it turns out to be still active
+	std::vector<std::deque<uint32_t> > wheel;
+	uint64_t                  tick_us   { 1 };
+	uint64_t                  cur_tick  { 0 };  // all slots before this one are processed
+
+	size_t find_slot(const uint32_t hash) const;
+	void   erase_at(size_t index);
+	void   schedule(const uint32_t hash, const uint64_t last_us);
+	void   advance(const uint64_t now_us);
+	void   evict_one();
+
+public:
+	// "storage": capacity(max_n) entries, kept up to date while
+	// checking; nullptr: allocated by the table itself
+	seen_table(const int max_per_dt, const double dt, const size_t max_n, seen_entry_t *const storage = nullptr);
+	virtual ~seen_table();
+
+	static size_t capacity(const size_t max_n);
+
+	// (re-)index the entries that are in "storage" (e.g. from a
+	// previous run), leaving out the ones that have expired
+	void   restore(const uint64_t now_us);
+
+	// true: not (too often) seen before
+	bool   check(const uint32_t hash, const uint64_t now_us);
+
+	size_t size() const { return n_used; }
+};
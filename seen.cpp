@@ -1,107 +1,226 @@
-#include <time.h>
-#include <vector>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "error.h"
 #include "hashing.h"
+#include "log.h"
 #include "seen.h"
 #include "str.h"
 #include "time.h"
 #include "utils.h"
 
 
+static constexpr int      max_shard_bits    { 4 };
+static constexpr uint64_t counters_flush_us { 1000000 };
+
+static_assert(sizeof(seen_persist_header_t) <= 64);
+
 seen::seen(const seen_t & pars) :
 	max_per_dt(pars.max_per_dt),
 	dt(pars.dt),
-	max_n(pars.max_seen_elements)
+	max_n(pars.max_seen_elements),
+	key(pars.key)
 {
-	th = new std::thread(std::ref(*this));
+	if (pars.shm_name.empty() == false) {
+		shared = new seen_shm(pars.shm_name, max_per_dt, dt, max_n);
+
+		return;
+	}
+
+	// a shard should hold at least a few entries
+	while(shard_bits < max_shard_bits && (max_n >> (shard_bits + 1)) >= 16)
+		shard_bits++;
+
+	int    n_shards       = 1 << shard_bits;
+
+	size_t max_n_shard    = (max_n + n_shards - 1) / n_shards;
+
+	size_t capacity_shard = seen_table::capacity(max_n_shard);
+
+	bool   restore        = pars.persist_file.empty() == false && map_persist_file(pars.persist_file, capacity_shard);
+
+	uint64_t now          = get_us();
+
+	shards = new seen_shard_t[n_shards];
+
+	for(int i=0; i<n_shards; i++) {
+		seen_entry_t *storage = nullptr;
+
+		if (persist_map)
+			storage = reinterpret_cast<seen_entry_t *>(&persist_map[64 + i * capacity_shard * sizeof(seen_entry_t)]);
+
+		shards[i].history    = new seen_table(max_per_dt, dt, max_n_shard, storage);
+		shards[i].n_hit      = 0;
+		shards[i].n_miss     = 0;
+
+		if (restore)
+			shards[i].history->restore(now);
+	}
 }
 
 seen::~seen()
 {
-	for(auto it : history)
-		delete it.second;
-
 	stop();
+
+	delete shared;
+
+	int n_shards = shards ? 1 << shard_bits : 0;
+
+	for(int i=0; i<n_shards; i++)
+		delete shards[i].history;
+
+	delete [] shards;
+
+	if (persist_map)
+		munmap(persist_map, persist_size);
+
+	if (persist_fd != -1)
+		close(persist_fd);  // also releases the lock
 }
 
-void seen::stop()
+// returns true if the file contains entries of a previous run
+bool seen::map_persist_file(const std::string & file, const size_t capacity)
 {
-	terminate = true;
+	constexpr uint32_t magic   = 0x4e535248;  // "HRSN"
+	constexpr uint32_t version = 1;
+
+	persist_size = 64 + (size_t(1) << shard_bits) * capacity * sizeof(seen_entry_t);
+
+	persist_fd   = open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (persist_fd == -1)
+		error_exit(true, "seen: cannot open \"%s\"", file.c_str());
+
+	// two seen objects writing in the same file would corrupt it
+	if (flock(persist_fd, LOCK_EX | LOCK_NB) == -1)
+		error_exit(true, "seen: \"%s\" is already in use", file.c_str());
+
+	seen_persist_header_t header { 0 };
+
+	struct stat st { 0 };
 
-	{
-		std::unique_lock<std::mutex> lck(history_lock);
-		history_cv.notify_one();
+	bool valid = fstat(persist_fd, &st) == 0 && size_t(st.st_size) == persist_size &&
+		pread(persist_fd, &header, sizeof header, 0) == sizeof header &&
+		header.magic      == magic &&
+		header.version    == version &&
+		header.entry_size == sizeof(seen_entry_t) &&
+		header.shard_bits == uint32_t(shard_bits) &&
+		header.capacity   == capacity &&
+		header.dt_us      == uint64_t(dt * 1000000) &&
+		header.max_per_dt == max_per_dt;
+
+	if (valid == false) {
+		// other settings (or no file yet): start empty
+		if (ftruncate(persist_fd, 0) == -1 || ftruncate(persist_fd, persist_size) == -1)
+			error_exit(true, "seen: cannot resize \"%s\"", file.c_str());
+
+		log(LL_INFO, "seen: \"%s\" initialized", file.c_str());
 	}
 
-	if (th) {
-		th->join();
+	persist_map = reinterpret_cast<uint8_t *>(mmap(nullptr, persist_size, PROT_READ | PROT_WRITE, MAP_SHARED, persist_fd, 0));
+	if (persist_map == MAP_FAILED)
+		error_exit(true, "seen: cannot mmap \"%s\"", file.c_str());
 
-		delete th;
+	if (valid == false) {
+		header.magic      = magic;
+		header.version    = version;
+		header.entry_size = sizeof(seen_entry_t);
+		header.shard_bits = shard_bits;
+		header.capacity   = capacity;
+		header.dt_us      = uint64_t(dt * 1000000);
+		header.max_per_dt = max_per_dt;
 
-		th = nullptr;
+		memcpy(persist_map, &header, sizeof header);
 	}
+
+	return valid;
 }
 
-std::pair<bool, uint32_t> seen::check(const uint8_t *const p, const size_t s)
+void seen::flush_counters()
 {
-	uint32_t hash = calc_crc32(p, s);
+	int n_shards = shards ? 1 << shard_bits : 0;
 
-	std::unique_lock<std::mutex> lck(history_lock);
+	for(int i=0; i<n_shards; i++) {
+		uint64_t n_hit  = shards[i].n_hit.exchange(0, std::memory_order_relaxed);
+		uint64_t n_miss = shards[i].n_miss.exchange(0, std::memory_order_relaxed);
 
-	rate_limiter *r = nullptr;
+		if (n_hit)
+			stats_add_counter(counter_hit, n_hit);
 
-	auto it = history.find(hash);
+		if (n_miss)
+			stats_add_counter(counter_miss, n_miss);
+	}
+}
 
-	if (it == history.end()) {
-		r = new rate_limiter(max_per_dt, dt);
+void seen::flusher()
+{
+	set_thread_name("seen-counters");
 
-		history.insert({ hash, r });
+	while(myusleep(counters_flush_us, &terminate))
+		flush_counters();
+}
 
-		history_cv.notify_one();
-	}
-	else {
-		r = it->second;
-	}
+void seen::stop()
+{
+	// entries expire while checking, only the counters thread to stop
+	terminate = true;
+
+	if (flush_th) {
+		flush_th->join();
+
+		delete flush_th;
 
-	bool rc = r->check();
+		flush_th = nullptr;
 
-	stats_inc_counter(rc ? counter_hit : counter_miss);
+		flush_counters();
+	}
+}
+
+std::pair<bool, uint32_t> seen::check(const uint8_t *const p, const size_t s)
+{
+	uint32_t hash = calc_digest(p, s);
 
-	return { rc, hash };
+	return { check(hash), hash };
 }
 
-void seen::operator()()
+bool seen::check(const uint32_t hash)
 {
-	set_thread_name("rl-hash");
+	uint64_t now  = get_us();
 
-	while(!terminate) {
-		std::unique_lock<std::mutex> lck(history_lock);
+	if (shared) {
+		bool rc = shared->check(hash, now);
 
-		while(history.size() < size_t(max_n) && terminate == false)
-			history_cv.wait_for(lck, std::chrono::milliseconds(END_CHECK_INTERVAL_ms));
+		stats_inc_counter(rc ? counter_hit : counter_miss);
 
-		std::vector<std::pair<uint32_t, time_t> > map;
+		return rc;
+	}
 
-		for(auto it : history)
-			map.push_back({ it.first, it.second->get_last_ts() });
+	seen_shard_t *shard = &shards[shard_bits ? hash >> (32 - shard_bits) : 0];
 
-		std::sort(map.begin(), map.end(),
-				[](const std::pair<uint32_t, time_t> & a, const std::pair<uint32_t, time_t> & b) -> bool
-				{
-					return a.second > b.second;
-				});
+	std::unique_lock<std::mutex> lck(shard->lock);
 
-		int lower_bound = history.size() - max_n + max_n / 10;
+	bool rc = shard->history->check(hash, now);
 
-		for(int i=0; i<lower_bound; i++) {
-			uint32_t cur_hash = map.at(i).first;
+	lck.unlock();
 
-			delete history.find(cur_hash)->second;
+	(rc ? shard->n_hit : shard->n_miss).fetch_add(1, std::memory_order_relaxed);
 
-			history.erase(cur_hash);
-		}
+	return rc;
+}
+
+bool seen::check(const message & m)
+{
+	if (key == sk_aprs) {
+		auto digest = m.get_aprs_digest();  // cached in the message
+
+		if (digest.has_value())
+			return check(digest.value());
 	}
+
+	return check(m.get_digest());
 }
 
 seen *seen::instantiate(const libconfig::Setting & node_in)
@@ -119,10 +238,27 @@ seen *seen::instantiate(const libconfig::Setting & node_in)
 			pars_seen.dt                = int(node_in.lookup(type));
 		else if (type == "max-n-elements")
 			pars_seen.max_seen_elements = node_in.lookup(type);
+		else if (type == "persist-file")
+			pars_seen.persist_file      = node_in.lookup(type).c_str();
+		else if (type == "shared-memory")
+			pars_seen.shm_name          = node_in.lookup(type).c_str();
+		else if (type == "dedupe-key") {
+			std::string key_name = node_in.lookup(type).c_str();
+
+			if (key_name == "frame")
+				pars_seen.key = sk_frame;
+			else if (key_name == "aprs")
+				pars_seen.key = sk_aprs;
+			else
+				error_exit(false, "(line %d): dedupe-key must be \"frame\" or \"aprs\"", node.getSourceLine());
+		}
 		else
 			error_exit(false, "(line %d): setting \"%s\" is not known", node_in.getSourceLine(), type.c_str());
         }
 
+	if (pars_seen.persist_file.empty() == false && pars_seen.shm_name.empty() == false)
+		error_exit(false, "(line %d): persist-file and shared-memory cannot be combined", node_in.getSourceLine());
+
 	return new seen(pars_seen);
 }
 
@@ -130,4 +266,7 @@ void seen::register_snmp_counters(stats *const st, const std::string & parent_id
 {
 	counter_hit  = st->register_stat(myformat("seen-%s-hit",  parent_id.c_str()), myformat("1.3.6.1.2.1.4.57850.2.3.%zu.1", device_nr), snmp_integer::si_counter64);
 	counter_miss = st->register_stat(myformat("seen-%s-miss", parent_id.c_str()), myformat("1.3.6.1.2.1.4.57850.2.3.%zu.2", device_nr), snmp_integer::si_counter64);
+
+	if (shards && flush_th == nullptr)
+		flush_th = new std::thread(&seen::flusher, this);
 }
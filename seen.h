@@ -1,41 +1,82 @@
 #pragma once
 
 #include <atomic>
-#include <condition_variable>
 #include <libconfig.h++>
-#include <map>
 #include <mutex>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 #include <thread>
 
-#include "rate-limiter.h"
+#include "message.h"
+#include "seen-shm.h"
+#include "seen-table.h"
 #include "stats.h"
 
 
+// sk_aprs: APRS packets are recognised by from, to and information field
+// only, so that copies via other digipeaters (or APRS-IS) are duplicates
+typedef enum { sk_frame, sk_aprs } seen_key_t;
+
 typedef struct {
-	int    max_per_dt;
-	double dt;
-	int    max_seen_elements;
+	int         max_per_dt;
+	double      dt;
+	int         max_seen_elements;
+	seen_key_t  key;
+	std::string persist_file;  // empty: in memory only
+	std::string shm_name;      // not empty: use a seen_shm shared with other processes
 } seen_t;
 
+// start of a "persist-file"; the shards follow at offset 64
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entry_size;
+	uint32_t shard_bits;
+	uint64_t capacity;  // per shard
+	uint64_t dt_us;
+	int64_t  max_per_dt;
+} seen_persist_header_t;
+
+// hit/miss are counted per shard and added to the shared counters by
+// a thread, once per second, so that checks do not all write to the
+// same cache line
+typedef struct alignas(64) {  // no false sharing between shards
+	std::mutex  lock;
+	seen_table *history;
+	std::atomic_uint64_t n_hit;
+	std::atomic_uint64_t n_miss;
+} seen_shard_t;
+
 class seen
 {
 private:
 	const int    max_per_dt { 0 };
 	const double dt         { 0 };
 	const int    max_n      { 0 };
+	const seen_key_t key    { sk_frame };
+
+	// the table is split by the upper bits of the hash; each part
+	// has its own lock so that receivers rarely wait for each other
+	int           shard_bits { 0 };
+	seen_shard_t *shards     { nullptr };
 
-	std::condition_variable            history_cv;
-	std::map<uint32_t, rate_limiter *> history;
-	std::mutex                         history_lock;
+	seen_shm     *shared     { nullptr };  // instead of the shards
 
-	uint64_t        *counter_hit  { nullptr };
-	uint64_t        *counter_miss { nullptr };
+	int           persist_fd   { -1      };
+	uint8_t      *persist_map  { nullptr };
+	size_t        persist_size { 0       };
+
+	uint64_t     *counter_hit  { nullptr };
+	uint64_t     *counter_miss { nullptr };
 
 	std::atomic_bool terminate { false   };
+	std::thread  *flush_th     { nullptr };  // only with shards
+
+	void flush_counters();
+	void flusher();
 
-	std::thread     *th        { nullptr };
+	bool map_persist_file(const std::string & file, const size_t capacity);
 
 public:
 	seen(const seen_t & pars);
@@ -45,9 +86,13 @@ public:
 
 	std::pair<bool, uint32_t> check(const uint8_t *const p, const size_t s);
 
+	// "digest" as returned by calc_digest() / message::get_digest()
+	bool check(const uint32_t digest);
+
+	// uses the key selected in the configuration
+	bool check(const message & m);
+
 	static seen *instantiate(const libconfig::Setting & node);
 
 	void register_snmp_counters(stats *const st, const std::string & parent_id, const size_t device_nr);
-
-	void operator()();
 };
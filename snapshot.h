@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+// Read-mostly data (RCU-style): readers get a pointer to an immutable
+// version without taking a lock, writers copy the current version,
+// modify the copy and publish it atomically.
+// Old versions are only freed when the snapshot object is destroyed as
+// readers may still be using them. This is fine for data that only
+// changes while the configuration is loaded.
+template <typename T>
+class snapshot
+{
+private:
+	std::atomic<const T *> current { nullptr };
+
+	std::mutex             update_lock;
+	std::vector<const T *> retired;
+
+public:
+	snapshot() : current(new T()) {
+	}
+
+	virtual ~snapshot() {
+		delete current.load();
+
+		for(auto p : retired)
+			delete p;
+	}
+
+	const T * get() const {
+		return current.load(std::memory_order_acquire);
+	}
+
+	template <typename F>
+	void update(F && f) {
+		std::unique_lock<std::mutex> lck(update_lock);
+
+		T *copy = new T(*current.load(std::memory_order_relaxed));
+
+		f(copy);
+
+		retired.push_back(current.exchange(copy, std::memory_order_acq_rel));
+	}
+};
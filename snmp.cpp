@@ -1,5 +1,4 @@
 // (C) 2021-2022 by folkert van heusden <mail@vanheusden.com>, released under Apache License v2.0
-#include <poll.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <arpa/inet.h>
@@ -16,20 +15,40 @@
 #include "utils.h"
 
 
-snmp::snmp(snmp_data *const sd, stats *const s, const int port) :
+snmp::snmp(snmp_data *const sd, stats *const s, const int port, reactor *const r) :
 	sd(sd),
 	s(s),
-	port(port)
+	port(port),
+	r(r)
 {
-	th = new std::thread(std::ref(*this));
+	if (port == -1)
+		return;
+
+	log(LL_INFO, "Starting SNMP server");
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd == -1)
+		error_exit(true, "snmp: socket() failed");
+
+	struct sockaddr_in servaddr { 0 };
+
+	servaddr.sin_family      = AF_INET; // IPv4
+	servaddr.sin_addr.s_addr = INADDR_ANY;
+	servaddr.sin_port        = htons(port);
+
+	if (bind(fd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) == -1)
+		error_exit(true, "snmp: bind() failed");
+
+	r->add(fd, [this] { return receive_ready(); });
 }
 
 snmp::~snmp()
 {
-	terminate = true;
+	if (fd != -1) {
+		r->remove(fd);
 
-	th->join();
-	delete th;
+		close(fd);
+	}
 }
 
 uint64_t snmp::get_INTEGER(const uint8_t *p, const size_t length)
@@ -354,51 +373,21 @@ bool snmp::input(const int fd, const uint8_t *const data, const size_t data_len,
 	return ok;
 }
 
-void snmp::operator()()
+bool snmp::receive_ready()
 {
-	set_thread_name("snmp");
+	try {
+		char               buffer[1600] { 0 };
+		struct sockaddr_in clientaddr   { 0 };
+		socklen_t          len = sizeof(clientaddr);
 
-	if (port == -1)
-		return;
-
-	log(LL_INFO, "Starting SNMP server");
+		int n = recvfrom(fd, buffer, sizeof buffer, MSG_DONTWAIT, (sockaddr *)&clientaddr, &len);
 
-	int fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd == -1)
-		error_exit(true, "snmp: socket() failed");
-
-	struct sockaddr_in servaddr { 0 };
-
-	servaddr.sin_family      = AF_INET; // IPv4
-	servaddr.sin_addr.s_addr = INADDR_ANY;
-	servaddr.sin_port        = htons(port);
-
-	if (bind(fd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) == -1)
-		error_exit(true, "snmp: bind() failed");
-
-	pollfd fds[] = { { fd, POLLIN, 0 } };
-
-	for(;!terminate;) {
-		try {
-			int rc = poll(fds, 1, 100);
-
-			if (rc == 0)
-				continue;
-
-			if (rc == -1)
-				error_exit(true, "snmp: poll failed");
-
-			char               buffer[1600] { 0 };
-			struct sockaddr_in clientaddr   { 0 };
-			socklen_t          len = sizeof(clientaddr);
-
-			int n = recvfrom(fd, buffer, sizeof buffer, 0, (sockaddr *)&clientaddr, &len);
-
-			if (n > 0)
-				input(fd, reinterpret_cast<uint8_t *>(buffer), n, (const sockaddr *)&clientaddr, len);
-                }
-                catch(const std::exception& e) {
-                        log(LL_ERROR, "snmp::operator(): exception %s", e.what());
-                }
+		if (n > 0)
+			input(fd, reinterpret_cast<uint8_t *>(buffer), n, (const sockaddr *)&clientaddr, len);
+	}
+	catch(const std::exception& e) {
+		log(LL_ERROR, "snmp::receive_ready(): exception %s", e.what());
 	}
+
+	return true;
 }
@@ -1,12 +1,11 @@
 // (C) 2021-2022 by folkert van heusden <mail@vanheusden.com>, released under Apache License v2.0
 #pragma once
-#include <atomic>
 #include <stdint.h>
 #include <string>
-#include <thread>
 #include <vector>
 #include <netinet/in.h>
 
+#include "reactor.h"
 #include "snmp-data.h"
 #include "stats.h"
 
@@ -28,9 +27,10 @@ private:
 	snmp_data *const sd;
 	stats     *const s;
 	const int        port      { 161     };
+	reactor   *const r         { nullptr };
+	int              fd        { -1      };
 
-	std::thread     *th        { nullptr };
-	std::atomic_bool terminate { false   };
+	bool receive_ready();
 
 	bool process_BER(const uint8_t *p, const size_t len, oid_req_t *const oids_req, const bool is_getnext, const int is_top);
 	uint64_t get_INTEGER(const uint8_t *p, const size_t len);
@@ -43,11 +43,9 @@ private:
 	void gen_reply(oid_req_t & oids_req, uint8_t **const packet_out, size_t *const output_size);
 
 public:
-	snmp(snmp_data *const sd, stats *const s, const int port);
+	snmp(snmp_data *const sd, stats *const s, const int port, reactor *const r);
 	snmp(const snmp &) = delete;
 	virtual ~snmp();
 
 	bool input(const int fd, const uint8_t *const data, const size_t data_len, const sockaddr *const a, const size_t a_len);
-
-	void operator()();
 };
@@ -1,4 +1,5 @@
 // (C) 2020-2022 by folkert van heusden <mail@vanheusden.com>, released under Apache License v2.0
+#include <algorithm>
 #include <assert.h>
 #include <cstring>
 #include <fcntl.h>
@@ -15,6 +16,10 @@
 
 constexpr char shm_name[] = "/lora-aprs-gw";
 
+// the address range is reserved at once so that the pointers that
+// register_stat() returned stay valid when the segment grows
+constexpr int  max_size   = 16 * 1024 * 1024;
+
 void stats_inc_counter(uint64_t *const p)
 {
 	if (!p)
@@ -78,19 +83,19 @@ stats::stats(const int size, snmp_data *const sd) :
 	if (ftruncate(fd, size) == -1)
 		error_exit(true, "stats: truncate");
 
-	p = (uint8_t *)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	p = (uint8_t *)mmap(nullptr, max_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
 	if (p == MAP_FAILED)
 		error_exit(true, "stats: mmap");
 
 	memset(p, 0x00, size);
-
-	close(fd);
 }
 
 stats::~stats()
 {
 	log(LL_DEBUG, "Removing shared memory segment\n");
-	munmap(p, size);
+	munmap(p, max_size);
+
+	close(fd);
 
 	shm_unlink(shm_name);
 }
@@ -99,11 +104,21 @@ uint64_t * stats::register_stat(const std::string & name, const std::string & oi
 {
 	log(LL_DEBUG_VERBOSE, "Registering statistic %s on oid %s", name.c_str(), oid.c_str());
 
-	if (len + 48 > size)
-		error_exit(false, "stats: shm is full");
-
 	std::unique_lock<std::mutex> lck(lock);
 
+	if (len + 48 > size) {
+		// e.g. many axudp peers; the new part is zeroed by the kernel
+		int new_size = std::min(size * 2, max_size);
+
+		if (len + 48 > new_size)
+			error_exit(false, "stats: shm is full");
+
+		if (ftruncate(fd, new_size) == -1)
+			error_exit(true, "stats: truncate");
+
+		size = new_size;
+	}
+
 	auto lut_it = lut.find(name);
 	if (lut_it != lut.end())
 		error_exit(false, "stats: stat \"%s\" already exists", name.c_str());
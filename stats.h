@@ -31,10 +31,10 @@ typedef struct _oid_t_ {
 class stats
 {
 private:
-	const int        size { 0 };
+	int              size { 0 };  // grows on demand, up to max_size
 	snmp_data *const sd   { nullptr };
 	int              fd   { -1 };
-	uint8_t         *p    { nullptr };
+	uint8_t         *p    { nullptr };  // max_size bytes of address space
 	int              len  { 0 };
 
 	std::map<std::string, stats_t>      lut;
@@ -42,6 +42,7 @@ private:
 	mutable std::mutex lock;
 
 public:
+	// "size": initial size of the shared memory segment
 	stats(const int size, snmp_data *const sd);
 	virtual ~stats();
 
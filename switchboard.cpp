@@ -1,32 +1,53 @@
+#include <inttypes.h>
+
 #include "log.h"
+#include "str.h"
 #include "switchboard.h"
 
 
-switchboard::switchboard()
+switchboard::switchboard(stats *const st, const size_t cache_size) :
+	cache_size(cache_size)
 {
+	cnt_cache_hit  = st->register_stat("switchboard-cache-hit",  "1.3.6.1.2.1.4.57850.2.7.1", snmp_integer::si_counter64);
+	cnt_cache_miss = st->register_stat("switchboard-cache-miss", "1.3.6.1.2.1.4.57850.2.7.2", snmp_integer::si_counter64);
 }
 
 switchboard::~switchboard()
 {
-	for(auto & mapping : routing_map)
+	for(auto & mapping : tables.get()->routing_map)
 		delete mapping;
 }
 
-void switchboard::add_bridge_mapping(tranceiver *const in, tranceiver *const out, const std::optional<filter_t> & f)
+// each version of the tables gets its own (empty) cache
+void switchboard::reset_cache(sb_tables_t *const work)
+{
+	if (cache_size > 0)
+		work->cache = std::make_shared<lru_cache<std::string, std::vector<tranceiver *> > >(cache_size);
+}
+
+void switchboard::add_bridge_mapping(const tranceiver *const in, tranceiver *const out, const std::optional<filter_t> & f)
 {
 	if (in == out)
 		return;
 
-	std::unique_lock<std::mutex> lck(lock);
+	tables.update([this, in, out, &f](sb_tables_t *const work) {
+		reset_cache(work);
 
-	auto it = bridge_map.find(in);
+		if (f.has_value()) {
+			for(auto & field : get_filter_fields(*f.value().program))
+				work->cache_fields.insert(field);
+		}
 
-	if (it == bridge_map.end()) {
-		sb_bridge_mapping_t mapping { f, { out } };
+		auto it = work->bridge_map.find(in);
+
+		if (it == work->bridge_map.end()) {
+			sb_bridge_mapping_t mapping { f, { out } };
+
+			work->bridge_map.insert({ in, { mapping } });
+
+			return;
+		}
 
-		bridge_map.insert({ in, { mapping } });
-	}
-	else {
 		for(auto & mapping : it->second) {
 			if (mapping.f.has_value() == false && f.has_value() == false)  {
 				mapping.t.push_back(out);
@@ -41,103 +62,149 @@ void switchboard::add_bridge_mapping(tranceiver *const in, tranceiver *const out
 				}
 			}
 		}
-	}
+
+		// same source, other filter
+		it->second.push_back({ f, { out } });
+	});
 }
 
 void switchboard::add_routing_mapping(sb_routing_mapping_t *const m)
 {
-	std::unique_lock<std::mutex> lck(lock);
+	tables.update([this, m](sb_tables_t *const work) {
+		reset_cache(work);
+
+		work->routing_map.push_back(m);
 
-	routing_map.push_back(m);
+		work->cache_fields.insert("from");
+		work->cache_fields.insert("to"  );
+
+		// rebuilt from scratch: only happens while loading the configuration
+		auto from_matcher = std::make_shared<callsign_matcher>();
+		auto to_matcher   = std::make_shared<callsign_matcher>();
+
+		for(auto & mapping : work->routing_map) {
+			from_matcher->add(mapping->from_callsign);
+			to_matcher  ->add(mapping->to_callsign  );
+		}
+
+		work->from_matcher = from_matcher;
+		work->to_matcher   = to_matcher;
+	});
 }
 
-transmit_error_t switchboard::put_message(tranceiver *const from, const message & m, const bool continue_on_error)
+// the cache key: everything that the bridge filters and routing mappings look at
+std::string switchboard::get_cache_key(const sb_tables_t *const current, const tranceiver *const from, const message & m)
 {
-	std::unique_lock<std::mutex> lck(lock);  // TODO: r/w lock
+	std::string key = myformat("%p|%p", from, m.get_source());
 
-	bool forwarded = false;
+	if (current->cache_fields.empty())
+		return key;
 
-	/* first process bridge mapping(s) */
-	auto it = bridge_map.find(from);
+	auto & meta = m.get_meta();
 
-	if (it != bridge_map.end()) {
-		for(auto & target_filters_pair : it->second) {
-			if (target_filters_pair.f.has_value() == false || execute_filter(target_filters_pair.f.value().pattern, target_filters_pair.f.value().ignore_if_field_is_missing, m)) {
-				log(LL_DEBUG, "Forwarding %s to %zu tranceivers", m.get_id_short().c_str(), target_filters_pair.t.size());
+	for(auto & field : current->cache_fields) {
+		auto value = meta.find(field);
 
-				for(auto t : target_filters_pair.t) {
-					t->mlog(LL_DEBUG_VERBOSE, m, "put_message", "(bridge) Forwarding to " + t->get_id());
+		if (value == nullptr)
+			key += "|-";
+		else
+			key += myformat("|%d:%" PRIu64 ":%.17g:", value->dt, value->i_value, value->d_value) + value->s_value;
+	}
 
-					transmit_error_t rc = t->put_message(m);
+	return key;
+}
 
-					if (rc != TE_ok && continue_on_error == false)
-						return rc;
-				}
+std::vector<tranceiver *> switchboard::resolve_targets(const sb_tables_t *const current, const tranceiver *const from, const message & m)
+{
+	std::vector<tranceiver *> targets;
 
-				forwarded = true;
-			}
+	/* first process bridge mapping(s) */
+	auto it = current->bridge_map.find(from);
+
+	if (it != current->bridge_map.end()) {
+		for(auto & target_filters_pair : it->second) {
+			if (target_filters_pair.f.has_value() == false || execute_filter(target_filters_pair.f.value(), m))
+				targets.insert(targets.end(), target_filters_pair.t.begin(), target_filters_pair.t.end());
 		}
 	}
 
 	/* second, process routing mapping(s) */
 
-	for(auto & mapping : routing_map) {
-		auto meta = m.get_meta();
+	if (current->routing_map.empty())
+		return targets;
 
-		// check from
-		auto it   = meta.find("from");
-		if (it == meta.end())
-			continue;
+	auto & meta    = m.get_meta();
 
-		int rc    = regexec(&mapping->re_from_callsign, it->second.s_value.c_str(), 0, nullptr, 0);
+	auto   mfrom   = meta.find(mk_from);
+	auto   mto     = meta.find(mk_to  );
 
-		if (rc == REG_NOMATCH)
-			continue;
+	if (mfrom != nullptr && mto != nullptr) {
+		// one pass over all from- and one over all to-patterns
+		auto from_matches = current->from_matcher->match(mfrom->s_value);
+		auto to_matches   = current->to_matcher  ->match(mto  ->s_value);
 
-		if (rc != 0) {
-			log_regexp_error(rc, &mapping->re_from_callsign, "put_message: regexec for from-callsign");
+		for(size_t i=0; i<current->routing_map.size(); i++) {
+			if (callsign_is_match(from_matches, i) == false || callsign_is_match(to_matches, i) == false)
+				continue;
 
-			continue;
-		}
+			auto mapping = current->routing_map.at(i);
 
-		// check to
-		it        = meta.find("to");
-		if (it == meta.end())
-			continue;
+			// check incoming tranceiver
+			if (mapping->t_incoming_via != nullptr && mapping->t_incoming_via != m.get_source())
+				continue;
 
-		rc = regexec(&mapping->re_to_callsign, it->second.s_value.c_str(), 0, nullptr, 0);
+			targets.insert(targets.end(), mapping->t_outgoing_via.begin(), mapping->t_outgoing_via.end());
+		}
+	}
 
-		if (rc == REG_NOMATCH)
-			continue;
+	return targets;
+}
 
-		if (rc != 0) {
-			log_regexp_error(rc, &mapping->re_to_callsign, "put_message: regexec for to-callsign");
+transmit_error_t switchboard::put_message(const tranceiver *const from, const message & m, const bool continue_on_error)
+{
+	// no locking: the tables are an immutable snapshot
+	const sb_tables_t *current = tables.get();
 
-			continue;
-		}
+	std::vector<tranceiver *> targets;
+
+	if (current->cache) {
+		std::string key    = get_cache_key(current, from, m);
 
-		// check incoming tranceiver
-		if (mapping->t_incoming_via != nullptr && mapping->t_incoming_via != m.get_source())
-			continue;
+		auto        cached = current->cache->get(key);
 
-		// all is fine, put in outgoing tranceivers' queues
-		for(auto t : mapping->t_outgoing_via) {
-			transmit_error_t t_rc = t->put_message(m);
+		if (cached.has_value()) {
+			stats_inc_counter(cnt_cache_hit);
 
-			t->mlog(LL_DEBUG_VERBOSE, m, "put_message", "(router) Forwarding to " + t->get_id());
+			targets = cached.value();
+		}
+		else {
+			stats_inc_counter(cnt_cache_miss);
 
-			if (t_rc != TE_ok && continue_on_error == false)
-				return t_rc;
+			targets = resolve_targets(current, from, m);
 
-			forwarded = true;
+			current->cache->put(key, targets);
 		}
 	}
+	else {
+		targets = resolve_targets(current, from, m);
+	}
 
-	if (!forwarded) {
+	if (targets.empty()) {
 		log(LL_DEBUG, "NOT forwarding message %s (due to filtering or no bridge/routing match)", m.get_id_short().c_str());
 
 		return TE_filter;
 	}
 
+	log(LL_DEBUG, "Forwarding %s to %zu tranceivers", m.get_id_short().c_str(), targets.size());
+
+	for(auto t : targets) {
+		t->mlog(LL_DEBUG_VERBOSE, m, "put_message", "Forwarding to " + t->get_id());
+
+		transmit_error_t rc = t->put_message(m);
+
+		if (rc != TE_ok && continue_on_error == false)
+			return rc;
+	}
+
 	return TE_ok;
 }
@@ -1,9 +1,13 @@
 #include <map>
+#include <memory>
 #include <optional>
-#include <regex.h>
 #include <set>
 
+#include "callsign-matcher.h"
 #include "filter.h"
+#include "lru-cache.h"
+#include "snapshot.h"
+#include "stats.h"
 #include "tranceiver.h"
 
 
@@ -15,30 +19,55 @@ typedef struct
 
 typedef struct
 {
-	regex_t     re_from_callsign;
-	regex_t     re_to_callsign;
+	std::string from_callsign;  // regular expressions
+	std::string to_callsign;
 
-	tranceiver *t_incoming_via;
+	const tranceiver *t_incoming_via;
 
 	std::vector<tranceiver *> t_outgoing_via;
 } sb_routing_mapping_t;
 
+typedef struct
+{
+	std::map<const tranceiver *, std::vector<sb_bridge_mapping_t> > bridge_map;
+
+	std::vector<sb_routing_mapping_t *> routing_map;
+
+	// bit n is set for routing_map[n]
+	std::shared_ptr<const callsign_matcher> from_matcher;
+	std::shared_ptr<const callsign_matcher> to_matcher;
+
+	// the fields the bridge filters and routing mappings look at;
+	// when empty, the message does not need to be dissected
+	std::set<std::string> cache_fields;
+
+	// targets per message-key, nullptr when disabled
+	std::shared_ptr<lru_cache<std::string, std::vector<tranceiver *> > > cache;
+} sb_tables_t;
+
 class switchboard
 {
 private:
-	std::map<tranceiver *, std::vector<sb_bridge_mapping_t> > bridge_map;
-	
-	std::vector<sb_routing_mapping_t *> routing_map;
+	// only changes while the configuration is loaded
+	snapshot<sb_tables_t> tables;
+
+	const size_t          cache_size     { 0       };
+	uint64_t             *cnt_cache_hit  { nullptr };
+	uint64_t             *cnt_cache_miss { nullptr };
+
+	void reset_cache(sb_tables_t *const work);
+
+	static std::string get_cache_key(const sb_tables_t *const current, const tranceiver *const from, const message & m);
 
-	std::mutex lock;
+	static std::vector<tranceiver *> resolve_targets(const sb_tables_t *const current, const tranceiver *const from, const message & m);
 
 public:
-	switchboard();
+	switchboard(stats *const st, const size_t cache_size);
 	virtual ~switchboard();
 
-	void add_bridge_mapping(tranceiver *const in, tranceiver *const out, const std::optional<filter_t> & f);
+	void add_bridge_mapping(const tranceiver *const in, tranceiver *const out, const std::optional<filter_t> & f);
 
 	void add_routing_mapping(sb_routing_mapping_t *const m);
 
-	transmit_error_t put_message(tranceiver *const from, const message & m, const bool continue_on_error);
+	transmit_error_t put_message(const tranceiver *const from, const message & m, const bool continue_on_error);
 };
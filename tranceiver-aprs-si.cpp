@@ -47,9 +47,7 @@ transmit_error_t tranceiver_aprs_si::put_message_low(const message & m)
 
 	stats_inc_counter(cnt_frame_aprs);
 
-	auto rate_limit_rc = s->check(content.first, content.second);
-
-	if (rate_limit_rc.first == false) {
+	if (s->check(m) == false) {
 		mlog(LL_DEBUG_VERBOSE, m, "put_message_low", "denied by rate limiter");
 
 		stats_inc_counter(cnt_frame_aprs_rate_limited);
@@ -1,7 +1,7 @@
+#include <algorithm>
 #include <assert.h>
 #include <errno.h>
 #include <optional>
-#include <poll.h>
 #include <pty.h>
 #include <stdio.h>
 #include <string>
@@ -24,6 +24,155 @@
 #include "utils.h"
 
 
+constexpr size_t   max_pkt_len         { 1600 };
+constexpr size_t   rx_batch            { 16   };  // datagrams per recvmmsg()
+
+constexpr uint64_t resolve_interval_us { 300 * 1000000ll };  // dns changes
+constexpr uint64_t resolve_retry_us    {  10 * 1000000ll };  // failed before
+
+// invoked from the constructor and then only by the resolver thread
+// (th): getaddrinfo() can block for seconds, so without peers_lock
+// held; that is only taken to store the new address
+void tranceiver_axudp::resolve_peers()
+{
+	uint64_t now = get_us();
+
+	for(auto & p : peers) {
+		if (now < p.next_resolve)
+			continue;
+
+		sockaddr_storage addr     { };
+		socklen_t        addr_len { 0 };
+
+		// when it fails, the previous address (if any) is kept
+		if (resolve_udp(p.host, AF_UNSPEC, &addr, &addr_len)) {
+			std::unique_lock<std::mutex> lck(peers_lock);
+
+			p.addr         = addr;
+			p.addr_len     = addr_len;
+			p.next_resolve = now + resolve_interval_us;
+		}
+		else {
+			p.next_resolve = now + resolve_retry_us;
+		}
+	}
+}
+
+// sendmmsg() stops at the first message that fails: continue after it;
+// msg_len stays 0 for the ones that were not sent
+static void sendmmsg_all(const int fd, mmsghdr *const msgs, const size_t n)
+{
+	size_t offset = 0;
+
+	while(offset < n) {
+		int rc = sendmmsg(fd, &msgs[offset], n - offset, 0);
+
+		if (rc == -1 && errno == EINTR)
+			continue;
+
+		offset += rc > 0 ? rc : 1;
+	}
+}
+
+// the frame to all "targets" (indexes in peers) in one system call per
+// address family (or one io_uring submission); false: one or more failed
+bool tranceiver_axudp::transmit_to_peers(const std::vector<size_t> & targets, const uint8_t *const p, const size_t len)
+{
+	std::vector<sockaddr_storage> addresses(targets.size());
+	std::vector<socklen_t>        addr_lens(targets.size());
+
+	{
+		std::unique_lock<std::mutex> lck(peers_lock);
+
+		for(size_t i=0; i<targets.size(); i++) {
+			addresses[i] = peers[targets[i]].addr;
+			addr_lens[i] = peers[targets[i]].addr_len;
+		}
+
+		// ipv6 peers are rare: only then a socket for it
+		bool has_ipv6 = std::any_of(addresses.begin(), addresses.end(), [](const sockaddr_storage & a) { return a.ss_family == AF_INET6; });
+
+		if (has_ipv6 && fd6 == -1) {
+			fd6 = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+
+			if (fd6 == -1)
+				log(LL_ERROR, myformat("cannot create ipv6 socket: %s", strerror(errno)));
+		}
+	}
+
+	std::vector<size_t> per_family[2];  // ipv4, ipv6
+
+	for(size_t i=0; i<targets.size(); i++) {
+		if (addr_lens[i] == 0) {  // not resolved
+			stats_inc_counter(peers[targets[i]].cnt_send_errors);
+
+			continue;
+		}
+
+		per_family[addresses[i].ss_family == AF_INET6].push_back(i);
+	}
+
+	bool ok = per_family[0].size() + per_family[1].size() == targets.size();
+
+	std::vector<bool> sent(targets.size());
+
+	if (r->get_io_uring()) {
+		std::vector<io_uring_send_t> items;
+
+		for(int family=0; family<2; family++) {
+			for(size_t i : per_family[family])
+				items.push_back({ family ? fd6 : fd, p, len, reinterpret_cast<const sockaddr *>(&addresses[i]), addr_lens[i], false });
+		}
+
+		r->get_io_uring()->transmit(items);
+
+		size_t nr = 0;
+
+		for(int family=0; family<2; family++) {
+			for(size_t i : per_family[family])
+				sent[i] = items[nr++].sent;
+		}
+	}
+	else {
+		iovec iov { const_cast<uint8_t *>(p), len };
+
+		for(int family=0; family<2; family++) {
+			size_t n = per_family[family].size();
+
+			if (n == 0)
+				continue;
+
+			std::vector<mmsghdr> msgs(n);  // zeroed
+
+			for(size_t j=0; j<n; j++) {
+				size_t i = per_family[family][j];
+
+				msgs[j].msg_hdr.msg_name    = &addresses[i];
+				msgs[j].msg_hdr.msg_namelen = addr_lens[i];
+				msgs[j].msg_hdr.msg_iov     = &iov;
+				msgs[j].msg_hdr.msg_iovlen  = 1;
+			}
+
+			sendmmsg_all(family ? fd6 : fd, msgs.data(), n);
+
+			for(size_t j=0; j<n; j++)
+				sent[per_family[family][j]] = msgs[j].msg_len == len;
+		}
+	}
+
+	for(size_t i=0; i<targets.size(); i++) {
+		if (addr_lens[i] && sent[i] == false) {
+			stats_inc_counter(peers[targets[i]].cnt_send_errors);
+
+			log(LL_DEBUG, myformat("transmit to %s failed", peers[targets[i]].host.c_str()));
+
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
 transmit_error_t tranceiver_axudp::put_message_low(const message & m)
 {
 	auto     content  = m.get_content();
@@ -38,151 +187,281 @@ transmit_error_t tranceiver_axudp::put_message_low(const message & m)
 	temp[len] = crc;
 	temp[len + 1] = crc >> 8;
 
-	for(auto p : peers) {
-		mlog(LL_DEBUG_VERBOSE, m, "put_message_low", myformat("transmit to %s (%s)", p.first.c_str(), dump_replace(temp, temp_len).c_str()));
-
-		if (transmit_udp(p.first, temp, temp_len) == false && continue_on_error == false) {
-			mlog(LL_WARNING, m, "put_message_low", "problem sending");
+	std::vector<size_t> targets;
 
-			free(temp);
+	for(size_t i=0; i<peers.size(); i++) {
+		mlog(LL_DEBUG_VERBOSE, m, "put_message_low", myformat("transmit to %s (%s)", peers[i].host.c_str(), dump_replace(temp, temp_len).c_str()));
 
-			return TE_hardware;
-		}
+		targets.push_back(i);
 	}
 
+	bool ok = transmit_to_peers(targets, temp, temp_len);
+
 	free(temp);
 
+	if (ok == false) {
+		mlog(LL_WARNING, m, "put_message_low", "problem sending");
+
+		if (continue_on_error == false)
+			return TE_hardware;
+	}
+
 	return TE_ok;
 }
 
-tranceiver_axudp::tranceiver_axudp(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, const int listen_port, const std::vector<std::pair<std::string, std::optional<filter_t> > > & peers, const bool continue_on_error, const bool distribute) :
+tranceiver_axudp::tranceiver_axudp(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, reactor *const r, const int listen_port, const std::vector<std::pair<std::string, std::optional<filter_t> > > & peers, const bool continue_on_error, const bool distribute, const int receive_threads, stats *const st, const size_t device_nr) :
 	tranceiver(id, s, w, gps),
+	r(r),
 	listen_port(listen_port),
-	peers(peers),
 	continue_on_error(continue_on_error),
 	distribute(distribute)
 {
 	log(LL_INFO, "Instantiated AXUDP");
 
-	fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	cnt_fcs_errors = st->register_stat(myformat("%s-fcs-errors", get_id().c_str()), myformat("1.3.6.1.2.1.4.57850.2.12.%zu", device_nr), snmp_integer::si_counter64);
+
+	for(size_t i=0; i<peers.size(); i++) {
+		axudp_peer_t p { peers[i].first, peers[i].second, { }, 0, 0, nullptr };
+
+		p.cnt_send_errors = st->register_stat(myformat("%s-peer-%zu-send-errors", get_id().c_str(), i + 1), myformat("1.3.6.1.2.1.4.57850.2.11.%zu.%zu", device_nr, i + 1), snmp_integer::si_counter64);
+
+		this->peers.push_back(p);
+	}
+
+	// resolve now so that the first frame is not delayed by it
+	resolve_peers();
+
+	for(int i=0; i<receive_threads; i++) {
+		axudp_receiver_t *rx = new axudp_receiver_t;
+
+		rx->fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+		// the kernel spreads the peers over the sockets (by address
+		// and port: the frames of a peer stay in order)
+		int on = 1;
+
+		if (receive_threads > 1 && setsockopt(rx->fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) == -1)
+			error_exit(true, "axudp(%s) SO_REUSEPORT failed", get_id().c_str());
 
-        struct sockaddr_in servaddr { 0 };
+		struct sockaddr_in servaddr { 0 };
 
-        servaddr.sin_family      = AF_INET; // IPv4
-        servaddr.sin_addr.s_addr = INADDR_ANY;
-        servaddr.sin_port        = htons(listen_port);
+		servaddr.sin_family      = AF_INET; // IPv4
+		servaddr.sin_addr.s_addr = INADDR_ANY;
+		servaddr.sin_port        = htons(listen_port);
 
-        if (bind(fd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) == -1)
-                error_exit(true, "axudp(%s) bind to port %d failed", get_id().c_str(), listen_port);
+		if (bind(rx->fd, (const struct sockaddr *)&servaddr, sizeof(servaddr)) == -1)
+			error_exit(true, "axudp(%s) bind to port %d failed", get_id().c_str(), listen_port);
+
+		rx->buffers = reinterpret_cast<uint8_t *>(malloc(rx_batch * max_pkt_len));
+
+		rx->iov.resize(rx_batch);
+		rx->from.resize(rx_batch);
+		rx->msgs.resize(rx_batch);
+
+		for(size_t j=0; j<rx_batch; j++) {
+			rx->iov[j].iov_base = rx->buffers + j * max_pkt_len;
+			rx->iov[j].iov_len  = max_pkt_len;
+
+			rx->msgs[j].msg_hdr.msg_name    = &rx->from[j];
+			rx->msgs[j].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+			rx->msgs[j].msg_hdr.msg_iov     = &rx->iov[j];
+			rx->msgs[j].msg_hdr.msg_iovlen  = 1;
+		}
+
+		receivers.push_back(rx);
+	}
+
+	fd = receivers.at(0)->fd;
+
+	if (listen_port != -1) {
+		for(auto rx : receivers)
+			watch_fd(r, rx->fd, [this, rx] { return receive_ready(rx); }, [this](const uint8_t *const p, const size_t len, const sockaddr *const from) { return receive_data(p, len, from); });
+	}
 
 	th = new std::thread(std::ref(*this));
 }
 
 tranceiver_axudp::~tranceiver_axudp()
 {
-	close(fd);
+	for(auto rx : receivers) {
+		close(rx->fd);
+
+		free(rx->buffers);
+
+		delete rx;
+	}
+
+	if (fd6 != -1)
+		close(fd6);
 }
 
-transmit_error_t tranceiver_axudp::send_to_other_axudp_targets(const message & m, const std::string & came_from)
+transmit_error_t tranceiver_axudp::send_to_other_axudp_targets(const message & m, const sockaddr *const came_from)
 {
-	for(auto p : peers) {
-		if (p.first == came_from) {
-			mlog(LL_DEBUG_VERBOSE, m, "send_to_other_axudp_targets", myformat("not (re-)sending to %s", p.first.c_str()));
+	std::vector<bool> is_sender(peers.size());
 
-			continue;
-		}
+	{
+		std::unique_lock<std::mutex> lck(peers_lock);
 
-		if (p.second.has_value() == false || execute_filter(p.second.value().pattern, p.second.value().ignore_if_field_is_missing, m)) {
-			mlog(LL_DEBUG_VERBOSE, m, "send_to_other_axudp_targets", myformat("transmit to %s", p.first.c_str()));
+		for(size_t i=0; i<peers.size(); i++)
+			is_sender[i] = peers[i].addr_len && sockaddr_equal(came_from, reinterpret_cast<const sockaddr *>(&peers[i].addr));
+	}
 
-			auto content = m.get_content();
+	std::vector<size_t> targets;
 
-			if (transmit_udp(p.first, content.first, content.second) == false && continue_on_error == false) {
-				mlog(LL_WARNING, m, "send_to_other_axudp_targets", "problem sending");
+	for(size_t i=0; i<peers.size(); i++) {
+		auto & p = peers[i];
 
-				return TE_hardware;
-			}
+		if (is_sender[i]) {
+			mlog(LL_DEBUG_VERBOSE, m, "send_to_other_axudp_targets", myformat("not (re-)sending to %s", p.host.c_str()));
+
+			continue;
+		}
+
+		if (p.f.has_value() == false || execute_filter(p.f.value(), m)) {
+			mlog(LL_DEBUG_VERBOSE, m, "send_to_other_axudp_targets", myformat("transmit to %s", p.host.c_str()));
+
+			targets.push_back(i);
 		}
 		else {
-			mlog(LL_DEBUG, m, "send_to_other_axudp_targets", myformat("not sending to %s due to filter", p.first.c_str()));
+			mlog(LL_DEBUG, m, "send_to_other_axudp_targets", myformat("not sending to %s due to filter", p.host.c_str()));
 		}
 	}
 
+	if (targets.empty())
+		return TE_ok;
+
+	auto content = m.get_content();
+
+	if (transmit_to_peers(targets, content.first, content.second) == false && continue_on_error == false) {
+		mlog(LL_WARNING, m, "send_to_other_axudp_targets", "problem sending");
+
+		return TE_hardware;
+	}
+
 	return TE_ok;
 }
 
+// receive_ready() is invoked by the reactor, this thread only
+// re-resolves the peers
 void tranceiver_axudp::operator()()
 {
-	set_thread_name("t-axudp");
+	set_thread_name("dns-" + get_id());
 
-	if (listen_port == -1)
-		return;
+	while(myusleep(1000000, &terminate))
+		resolve_peers();
+}
 
-	log(LL_INFO, "started thread");
+// the last 2 bytes are the crc of the frame
+bool tranceiver_axudp::fcs_ok(const uint8_t *const p, const size_t len, const sockaddr *const from)
+{
+	if (ok_crc(const_cast<uint8_t *>(p), len))
+		return true;
 
-	pollfd fds[] = { { fd, POLLIN, 0 } };
+	stats_inc_counter(cnt_fcs_errors);
 
-        for(;!terminate;) {
-                try {
-			int rc = poll(fds, 1, END_CHECK_INTERVAL_ms);
-			
-			if (rc == 0)
-				continue;
+	if (get_default_loglevel() >= LL_DEBUG)
+		log(LL_DEBUG, "dropped frame with bad FCS from " + sockaddr_to_str(from));
 
-			if (rc == -1) {
-				log(LL_ERROR, myformat("poll returned %s", strerror(errno)));
+	return false;
+}
 
-				break;
-			}
+// takes over "buffer"
+void tranceiver_axudp::process_datagram(uint8_t *const buffer, const int n, const sockaddr *const from)
+{
+	timeval tv = get_now_tv();
 
-			constexpr int       max_pkt_len { 1600 };
-                        char               *buffer      = reinterpret_cast<char *>(calloc(1, max_pkt_len));
-                        struct sockaddr_in  clientaddr  { 0 };
-                        socklen_t           len         = sizeof(clientaddr);
+	uint64_t    msg_id = get_random_uint64_t();
 
-                        int n = recvfrom(fd, buffer, max_pkt_len, 0, (sockaddr *)&clientaddr, &len);
+	// the received data is shared by both messages, not copied
+	::buffer    b_full(buffer, n, true);
 
-                        if (n > 2) {
-				std::string came_from = inet_ntoa(clientaddr.sin_addr) + myformat(":%d", clientaddr.sin_port);
+	message m(tv,
+			this,
+			msg_id,
+			b_full.get_slice(0, n - 2 /* "remove" crc */));
 
-				timeval tv = get_now_tv();
+	if (get_default_loglevel() >= LL_DEBUG_VERBOSE)
+		mlog(LL_DEBUG_VERBOSE, m, "operator", "received message from " + sockaddr_to_str(from));
 
-				uint64_t    msg_id = get_random_uint64_t();
+	// if an error occured, do not pass on to
+	transmit_error_t rc = queue_incoming_message(m);
 
-				message m(tv,
-						this,
-						msg_id,
-						reinterpret_cast<const uint8_t *>(buffer),
-						n - 2 /* "remove" crc */);
+	if (distribute && rc != TE_ratelimiting) {
+		message m_full(tv,
+			this,
+			msg_id,
+			b_full);
 
-				mlog(LL_DEBUG_VERBOSE, m, "operator", "received message from " + came_from);
+		send_to_other_axudp_targets(m_full, from);
+	}
+}
 
-				// if an error occured, do not pass on to
-				transmit_error_t rc = queue_incoming_message(m);
+// io_uring: "p" is only valid during this call
+bool tranceiver_axudp::receive_data(const uint8_t *const p, const size_t len, const sockaddr *const from)
+{
+	if (len > 2 && len <= max_pkt_len && from && fcs_ok(p, len, from)) {
+		uint8_t *buffer = reinterpret_cast<uint8_t *>(malloc(len));
 
-				if (distribute && rc != TE_ratelimiting) {
-					message m_full(tv,
-						this,
-						msg_id,
-						reinterpret_cast<const uint8_t *>(buffer),
-						n);
+		memcpy(buffer, p, len);
 
-					send_to_other_axudp_targets(m_full, came_from);
-				}
+		process_datagram(buffer, len, from);
+	}
+
+	return true;
+}
+
+bool tranceiver_axudp::receive_ready(axudp_receiver_t *const rx)
+{
+	// a few batches per wakeup, then give other inputs a chance
+	for(int batch=0; batch<4 && !terminate; batch++) {
+		for(auto & msg : rx->msgs)
+			msg.msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+
+		int n = recvmmsg(rx->fd, rx->msgs.data(), rx->msgs.size(), MSG_DONTWAIT, nullptr);
+
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				log(LL_WARNING, myformat("recvmmsg returned %s", strerror(errno)));
+
+			break;
+		}
+
+		for(int i=0; i<n; i++) {
+			size_t len = rx->msgs[i].msg_len;
+
+			if (len <= 2 || (rx->msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+				continue;
+
+			const sockaddr *from = reinterpret_cast<const sockaddr *>(&rx->from[i]);
+
+			if (fcs_ok(reinterpret_cast<const uint8_t *>(rx->iov[i].iov_base), len, from) == false)
+				continue;
+
+			try {
+				// the message gets a copy of the exact size; the
+				// receive buffers are reused
+				uint8_t *buffer = reinterpret_cast<uint8_t *>(malloc(len));
+
+				memcpy(buffer, rx->iov[i].iov_base, len);
+
+				process_datagram(buffer, len, from);
 			}
-			else if (n == -1) {
-				log(LL_WARNING, myformat("recvfrom returned %s", strerror(errno)));
+			catch(const std::exception& e) {
+				log(LL_ERROR, myformat("processing datagram failed: %s", e.what()));
 			}
+		}
 
-			free(buffer);
-                }
-                catch(const std::exception& e) {
-                        log(LL_ERROR, myformat("recvfrom failed: %s", e.what()));
-                }
-        }
+		if (size_t(n) < rx->msgs.size())  // nothing left
+			break;
+	}
+
+	return true;
 }
 
-tranceiver *tranceiver_axudp::instantiate(const libconfig::Setting & node_in, work_queue_t *const w, gps_connector *const gps, const std::map<std::string, filter_t> & filters)
+tranceiver *tranceiver_axudp::instantiate(const libconfig::Setting & node_in, work_queue_t *const w, gps_connector *const gps, reactor *const r, const std::map<std::string, filter_t> & filters, stats *const st, const size_t device_nr)
 {
 	std::string  id;
 	seen        *s                 = nullptr;
@@ -190,6 +469,7 @@ tranceiver *tranceiver_axudp::instantiate(const libconfig::Setting & node_in, wo
 	std::vector<std::pair<std::string, std::optional<filter_t> > > peers;
 	bool         continue_on_error = false;
 	bool         distribute        = false;
+	int          receive_threads   = 1;
 
         for(int i=0; i<node_in.getLength(); i++) {
                 const libconfig::Setting & node = node_in[i];
@@ -245,10 +525,16 @@ tranceiver *tranceiver_axudp::instantiate(const libconfig::Setting & node_in, wo
 			listen_port = node_in.lookup(type);
 		else if (type == "distribute")
 			distribute = node_in.lookup(type);
+		else if (type == "receive-threads") {
+			receive_threads = node_in.lookup(type);
+
+			if (receive_threads < 1)
+				error_exit(false, "axudp(line %d): receive-threads must be 1 or more", node.getSourceLine());
+		}
 		else if (type != "type") {
 			error_exit(false, "axudp(line %d): setting \"%s\" is not known", node.getSourceLine(), type.c_str());
 		}
         }
 
-	return new tranceiver_axudp(id, s, w, gps, listen_port, peers, continue_on_error, distribute);
+	return new tranceiver_axudp(id, s, w, gps, r, listen_port, peers, continue_on_error, distribute, receive_threads, st, device_nr);
 }
@@ -1,31 +1,73 @@
+#include <mutex>
 #include <string>
 #include <vector>
+#include <netinet/in.h>
 
 #include "filter.h"
+#include "stats.h"
 #include "tranceiver.h"
 
 
+typedef struct {
+	std::string             host;  // host:port
+	std::optional<filter_t> f;
+
+	// resolved once and then every few minutes; addr_len 0: not (yet)
+	sockaddr_storage        addr;
+	socklen_t               addr_len;
+	uint64_t                next_resolve;  // get_us(), only used by resolve_peers()
+
+	uint64_t               *cnt_send_errors;
+} axudp_peer_t;
+
+// one per listen socket: recvmmsg() batches into buffers that are
+// allocated once
+typedef struct {
+	int                           fd;
+	uint8_t                      *buffers;
+	std::vector<iovec>            iov;
+	std::vector<sockaddr_storage> from;
+	std::vector<mmsghdr>          msgs;
+} axudp_receiver_t;
+
 class tranceiver_axudp : public tranceiver
 {
 private:
-	int        fd                { -1    };
+	reactor   *const r           { nullptr };
+	int        fd                { -1    };  // the first of receivers, also for transmitting to ipv4 peers
+	int        fd6               { -1    };  // ipv6 peers
 	const int  listen_port       { -1    };
-	std::vector<std::pair<std::string, std::optional<filter_t> > > peers;
+
+	// more than 1: SO_REUSEPORT sockets, read in parallel
+	std::vector<axudp_receiver_t *> receivers;
+
+	std::mutex peers_lock;  // for the addresses
+	std::vector<axudp_peer_t> peers;
 	const bool continue_on_error { false };
 	const bool distribute        { false };
 
-	transmit_error_t send_to_other_axudp_targets(const message & m, const std::string & came_from);
+	uint64_t  *cnt_fcs_errors    { nullptr };
+
+	transmit_error_t send_to_other_axudp_targets(const message & m, const sockaddr *const came_from);
+
+	void resolve_peers();
+	bool transmit_to_peers(const std::vector<size_t> & targets, const uint8_t *const p, const size_t len);
+
+	bool fcs_ok(const uint8_t *const p, const size_t len, const sockaddr *const from);
+	void process_datagram(uint8_t *const buffer, const int n, const sockaddr *const from);
+	bool receive_ready(axudp_receiver_t *const rx);
+	bool receive_data(const uint8_t *const p, const size_t len, const sockaddr *const from);
 
 protected:
 	transmit_error_t put_message_low(const message & m) override;
 
 public:
-	tranceiver_axudp(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, const int listen_port, const std::vector<std::pair<std::string, std::optional<filter_t> > > & peers, const bool continue_on_error, const bool distribute);
+	tranceiver_axudp(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, reactor *const r, const int listen_port, const std::vector<std::pair<std::string, std::optional<filter_t> > > & peers, const bool continue_on_error, const bool distribute, const int receive_threads, stats *const st, const size_t device_nr);
 	virtual ~tranceiver_axudp();
 
 	std::string get_type_name() const override { return "AXUDP"; }
 
-	static tranceiver *instantiate(const libconfig::Setting & node, work_queue_t *const w, gps_connector *const gps, const std::map<std::string, filter_t> & filters);
+	static tranceiver *instantiate(const libconfig::Setting & node, work_queue_t *const w, gps_connector *const gps, reactor *const r, const std::map<std::string, filter_t> & filters, stats *const st, const size_t device_nr);
 
 	void operator()() override;
 };
@@ -26,8 +26,9 @@ void insert_into_database(db *const d, const message & m)
 
 	db_record_insert(&record, "msg-id", db_record_gen(int64_t(m.get_msg_id())));
 
-	for(auto r : m.get_meta())
-		db_record_insert(&record, r.first, r.second);
+	m.get_meta().for_each([&record](const std::string & name, const db_record_data & value) {
+		db_record_insert(&record, name, value);
+	});
 
 	d->insert(record);
 }
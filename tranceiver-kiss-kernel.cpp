@@ -19,8 +19,8 @@
 #include "utils.h"
 
 
-tranceiver_kiss_kernel::tranceiver_kiss_kernel(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, const std::string & callsign, const std::string & if_up) :
-	tranceiver_kiss(id, s, w, gps)
+tranceiver_kiss_kernel::tranceiver_kiss_kernel(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, reactor *const r, const std::string & callsign, const std::string & if_up) :
+	tranceiver_kiss(id, s, w, gps, r)
 {
 	log(LL_INFO, "Instantiating KISS-kernel");
 
@@ -54,14 +54,14 @@ tranceiver_kiss_kernel::tranceiver_kiss_kernel(const std::string & id, seen *con
 
 	fd = fd_master;
 
-	th = new std::thread(std::ref(*this));
+	start_receiver();
 }
 
 tranceiver_kiss_kernel::~tranceiver_kiss_kernel()
 {
 }
 
-tranceiver *tranceiver_kiss_kernel::instantiate(const libconfig::Setting & node_in, work_queue_t *const w, gps_connector *const gps)
+tranceiver *tranceiver_kiss_kernel::instantiate(const libconfig::Setting & node_in, work_queue_t *const w, gps_connector *const gps, reactor *const r)
 {
 	std::string  id;
 	seen        *s = nullptr;
@@ -93,5 +93,5 @@ tranceiver *tranceiver_kiss_kernel::instantiate(const libconfig::Setting & node_
 	if (callsign.empty())
 		error_exit(false, "(line %d): No callsign selected", node_in.getSourceLine());
 
-	return new tranceiver_kiss_kernel(id, s, w, gps, callsign, if_up);
+	return new tranceiver_kiss_kernel(id, s, w, gps, r, callsign, if_up);
 }
@@ -4,10 +4,10 @@
 class tranceiver_kiss_kernel : public tranceiver_kiss
 {
 public:
-	tranceiver_kiss_kernel(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, const std::string & callsign, const std::string & if_up);
+	tranceiver_kiss_kernel(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, reactor *const r, const std::string & callsign, const std::string & if_up);
 	virtual ~tranceiver_kiss_kernel();
 
 	std::string get_type_name() const override { return "KISS-kernel"; }
 
-	static tranceiver *instantiate(const libconfig::Setting & node, work_queue_t *const w, gps_connector *const gps);
+	static tranceiver *instantiate(const libconfig::Setting & node, work_queue_t *const w, gps_connector *const gps, reactor *const r);
 };
@@ -22,8 +22,8 @@
 #include "utils.h"
 
 
-tranceiver_kiss_tty::tranceiver_kiss_tty(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, const std::string & tty_path, const int tty_bps) :
-	tranceiver_kiss(id, s, w, gps)
+tranceiver_kiss_tty::tranceiver_kiss_tty(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, reactor *const r, const std::string & tty_path, const int tty_bps) :
+	tranceiver_kiss(id, s, w, gps, r)
 {
 	log(LL_INFO, "Instantiating KISS-tty");
 
@@ -66,14 +66,14 @@ tranceiver_kiss_tty::tranceiver_kiss_tty(const std::string & id, seen *const s,
 	if (tcsetattr(fd, TCSANOW, &tty) != 0)
 		error_exit(true, "tranceiver_kiss_tty: tcsetattr failed");
 
-	th = new std::thread(std::ref(*this));
+	start_receiver();
 }
 
 tranceiver_kiss_tty::~tranceiver_kiss_tty()
 {
 }
 
-tranceiver *tranceiver_kiss_tty::instantiate(const libconfig::Setting & node_in, work_queue_t *const w, gps_connector *const gps)
+tranceiver *tranceiver_kiss_tty::instantiate(const libconfig::Setting & node_in, work_queue_t *const w, gps_connector *const gps, reactor *const r)
 {
 	std::string  id;
 	seen        *s            = nullptr;
@@ -102,5 +102,5 @@ tranceiver *tranceiver_kiss_tty::instantiate(const libconfig::Setting & node_in,
 		}
         }
 
-	return new tranceiver_kiss_tty(id, s, w, gps, tty_device, tty_baudrate);
+	return new tranceiver_kiss_tty(id, s, w, gps, r, tty_device, tty_baudrate);
 }
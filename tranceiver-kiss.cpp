@@ -1,7 +1,6 @@
 #include <assert.h>
 #include <errno.h>
 #include <optional>
-#include <poll.h>
 #include <pty.h>
 #include <stdio.h>
 #include <string>
@@ -24,97 +23,117 @@
 #define TFEND	0xdc
 #define TFESC	0xdd
 
-bool tranceiver_kiss::recv_mkiss(uint8_t **const p, int *const len)
+// called with each complete frame (without the FENDs)
+void tranceiver_kiss::process_frame(uint8_t *const p, int len)
 {
-	bool ok     = false;
-	bool escape = false;
+	int cmd = p[0] & 0x0f;
+
+	log(LL_DEBUG, myformat("port: %d, cmd: %d, len: %d", (p[0] >> 4) & 0x0f, cmd, len));
+
+	len--;
+
+	if (len)
+		memmove(&p[0], &p[1], len);
+
+	if (cmd == 1)
+		log(LL_DEBUG, myformat("TX delay: %d", p[1] * 10));
+	else if (cmd == 2)
+		log(LL_DEBUG, myformat("persistance: %d", p[1] * 256 - 1));
+	else if (cmd == 3)
+		log(LL_DEBUG, myformat("slot time: %dms", p[1] * 10));
+	else if (cmd == 4)
+		log(LL_DEBUG, myformat("txtail: %dms", p[1] * 10));
+	else if (cmd == 5)
+		log(LL_DEBUG, myformat("full duplex: %d", p[1]));
+	else if (cmd == 6)
+		log(LL_DEBUG, "set hardware: " + dump_hex(&p[1], len - 1));
+	else if (cmd == 15)
+		log(LL_INFO, "kernel asked for shutdown");
+
+	// the buffer takes over p
+	message m(get_now_tv(),
+			this,
+			get_random_uint64_t(),
+			buffer(p, len, true));
+
+	mlog(LL_DEBUG_VERBOSE, m, "operator", "received message: " + dump_hex(p, len));
+
+	queue_incoming_message(m);
+}
 
-	*p   = reinterpret_cast<uint8_t *>(malloc(MAX_PACKET_SIZE));
-	*len = 0;
+bool tranceiver_kiss::receive_ready()
+{
+	uint8_t in[512];
 
-	for(;!terminate;)
-	{
-		uint8_t buffer = 0;
+	ssize_t n = read(fd, in, sizeof in);
 
-		if (read(fd, &buffer, 1) == -1) {
-			if (errno == EINTR)
-				continue;
+	if (n == -1) {
+		if (errno == EINTR || errno == EAGAIN)
+			return true;
 
-			log(LL_ERROR, "failed reading from device");
+		log(LL_ERROR, myformat("failed reading from device: %s", strerror(errno)));
 
-			free(*p);
+		return false;
+	}
 
-			return false;
-		}
+	return receive_data(in, n);
+}
 
-		if (escape)
-		{
-			if (*len == MAX_PACKET_SIZE)
-				break;
+// KISS decoder: fed with whatever the device has available, so it never
+// waits for the rest of a frame
+bool tranceiver_kiss::receive_data(const uint8_t *const in, const size_t n)
+{
+	if (n == 0) {
+		log(LL_ERROR, "device went away");
 
-			if (buffer == TFEND)
-				(*p)[(*len)++] = FEND;
-			else if (buffer == TFESC)
-				(*p)[(*len)++] = FESC;
-			else
-				log(LL_WARNING, myformat("unexpected escape %02x", buffer));
+		return false;
+	}
 
-			escape = false;
-		}
-		else if (buffer == FEND)
-		{
-			if (*len) {
-				ok = true;
-				break;
+	for(size_t i=0; i<n; i++) {
+		uint8_t c = in[i];
+
+		if (rx_buffer == nullptr)
+			rx_buffer = reinterpret_cast<uint8_t *>(malloc(MAX_PACKET_SIZE));
+
+		if (c == FEND) {
+			// a FEND without data before it is a start marker
+			if (rx_len && rx_overflow == false) {
+				process_frame(rx_buffer, rx_len);
+
+				rx_buffer = nullptr;
 			}
 
-			// otherwise: first FEND, ignore
+			rx_len      = 0;
+			rx_escape   = false;
+			rx_overflow = false;
 		}
-		else if (buffer == FESC)
-			escape = true;
-		else
-		{
-			if (*len == MAX_PACKET_SIZE)
-				break;
+		else if (rx_overflow) {
+			// skip until the next FEND
+		}
+		else if (rx_escape) {
+			if (c == TFEND)
+				rx_buffer[rx_len++] = FEND;
+			else if (c == TFESC)
+				rx_buffer[rx_len++] = FESC;
+			else
+				log(LL_WARNING, myformat("unexpected escape %02x", c));
 
-			(*p)[(*len)++] = buffer;
+			rx_escape = false;
 		}
-	}
+		else if (c == FESC)
+			rx_escape = true;
+		else
+			rx_buffer[rx_len++] = c;
 
-	if (*len == 0)
-		ok = false;
-
-	if (ok)
-	{
-		int cmd = (*p)[0] & 0x0f;
-
-		log(LL_DEBUG, myformat("port: %d, cmd: %d, len: %d", ((*p)[0] >> 4) & 0x0f, cmd, *len));
-
-		(*len)--;
-
-		if (*len)
-			memcpy(&(*p)[0], &(*p)[1], *len);
-
-		if (cmd == 1)
-			log(LL_DEBUG, myformat("TX delay: %d", (*p)[1] * 10));
-		else if (cmd == 2)
-			log(LL_DEBUG, myformat("persistance: %d", (*p)[1] * 256 - 1));
-		else if (cmd == 3)
-			log(LL_DEBUG, myformat("slot time: %dms", (*p)[1] * 10));
-		else if (cmd == 4)
-			log(LL_DEBUG, myformat("txtail: %dms", (*p)[1] * 10));
-		else if (cmd == 5)
-			log(LL_DEBUG, myformat("full duplex: %d", (*p)[1]));
-		else if (cmd == 6)
-			log(LL_DEBUG, "set hardware: " + dump_hex(&(*p)[1], *len - 1));
-		else if (cmd == 15)
-			log(LL_INFO, "kernel asked for shutdown");
-	}
+		if (rx_len == MAX_PACKET_SIZE) {
+			log(LL_WARNING, "frame too large, dropped");
 
-	if (!ok)
-		free(*p);
+			rx_len      = 0;
+			rx_overflow = true;
+		}
+	}
 
-	return ok;
+	return true;
 }
 
 void escape_put(uint8_t **p, int *len, uint8_t c)
@@ -150,7 +169,17 @@ bool tranceiver_kiss::send_mkiss(const uint8_t cmd, const uint8_t channel, const
 
 	out[offset++] = FEND;
 
-	if (WRITE(fd, out, offset) != offset) {
+	bool ok = false;
+
+	if (r && r->get_io_uring()) {
+		std::vector<io_uring_send_t> items { { fd, out, size_t(offset), nullptr, 0, false } };
+
+		ok = r->get_io_uring()->transmit(items) == 1;
+	}
+	else
+		ok = WRITE(fd, out, offset) == offset;
+
+	if (ok == false) {
 		log(LL_ERROR, "failed writing to mkiss device");
 
 		free(out);
@@ -177,47 +206,23 @@ transmit_error_t tranceiver_kiss::put_message_low(const message & m)
 	return TE_hardware;
 }
 
-tranceiver_kiss::tranceiver_kiss(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps) :
-	tranceiver(id, s, w, gps)
+tranceiver_kiss::tranceiver_kiss(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, reactor *const r) :
+	tranceiver(id, s, w, gps),
+	r(r)
 {
 }
 
 tranceiver_kiss::~tranceiver_kiss()
 {
+	free(rx_buffer);
 }
 
-void tranceiver_kiss::operator()()
+void tranceiver_kiss::start_receiver()
 {
-	set_thread_name("t-kiss");
-
-	log(LL_INFO, "started thread");
-
-	pollfd fds[] = { { fd, POLLIN, 0 } };
-
-	while(!terminate) {
-		int rc = poll(fds, 1, END_CHECK_INTERVAL_ms);
-
-		if (rc == 0)
-			continue;
-
-		if (rc == -1)
-			break;
-
-		uint8_t *p   = nullptr;
-		int      len = 0;
-		if (!recv_mkiss(&p, &len))
-			continue;
-
-		message m(get_now_tv(),
-				this,
-				get_random_uint64_t(),
-				p,
-				len);
-
-		mlog(LL_DEBUG_VERBOSE, m, "operator", "received message: " + dump_hex(p, len));
-
-		free(p);
+	watch_fd(r, fd, [this] { return receive_ready(); }, [this](const uint8_t *const p, const size_t len, const sockaddr *const from) { return receive_data(p, len); });
+}
 
-		queue_incoming_message(m);
-	}
+void tranceiver_kiss::operator()()
+{
+	// no thread: receive_ready() is invoked by the reactor
 }
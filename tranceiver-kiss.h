@@ -5,18 +5,32 @@
 
 class tranceiver_kiss : public tranceiver
 {
+private:
+	reactor   *const r      { nullptr };
+
+	// receive state
+	uint8_t   *rx_buffer    { nullptr };  // MAX_PACKET_SIZE bytes
+	int        rx_len       { 0       };
+	bool       rx_escape    { false   };
+	bool       rx_overflow  { false   };
+
+	bool receive_ready();
+	bool receive_data(const uint8_t *const in, const size_t n);
+	void process_frame(uint8_t *const p, int len);
+
 protected:
 	std::mutex lock;
 	int        fd   { -1 };
 
-	bool recv_mkiss(uint8_t **const p, int *const len);
+	// call when fd is set
+	void start_receiver();
 
 	bool send_mkiss(const uint8_t cmd, const uint8_t channel, const uint8_t *const p, const int len);
 
 	transmit_error_t put_message_low(const message & m) override;
 
 public:
-	tranceiver_kiss(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps);
+	tranceiver_kiss(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps, reactor *const r);
 	virtual ~tranceiver_kiss();
 
 	virtual std::string get_type_name() const override { return "KISS-base"; }
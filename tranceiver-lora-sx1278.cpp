@@ -39,11 +39,11 @@ void * rx_f(void *in)
 			reinterpret_cast<uint8_t *>(rx->buf),
 			rx->size);
 
-	std::map<std::string, db_record_data> meta;
+	packet_meta meta;
 
-	meta.insert({ "rssi", db_record_gen(myformat("%ddBm", rx->RSSI)) });
+	meta.set(mk_rssi,     db_record_gen(myformat("%ddBm", rx->RSSI)));
 
-	meta.insert({ "air-time", db_record_gen(double(rx->Tpkt)) });
+	meta.set(mk_air_time, db_record_gen(double(rx->Tpkt)));
 
 	m.set_meta(meta);
 
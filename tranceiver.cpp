@@ -1,6 +1,5 @@
-#include "dissect-packet.h"
+#include "configuration.h"
 #include "error.h"
-#include "hashing.h"
 #include "log.h"
 #include "log.h"
 #include "str.h"
@@ -18,9 +17,13 @@
 #include "tranceiver-ws.h"
 
 
+constexpr size_t transmit_queue_size = 1024;
+
 tranceiver::tranceiver(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps) :
 	id(id),
+	outgoing(transmit_queue_size),
 	w(w),
+	shard(work_queue_assign(w)),
 	s(s),
 	gps(gps)
 {
@@ -28,136 +31,163 @@ tranceiver::tranceiver(const std::string & id, seen *const s, work_queue_t *cons
 
 tranceiver::~tranceiver()
 {
+	for(;;) {
+		auto m = outgoing.try_pop();
+
+		if (m.has_value() == false)
+			break;
+
+		delete m.value();
+	}
+
 	delete s;
 }
 
+void tranceiver::start_transmitter()
+{
+	tx_th = new std::thread(&tranceiver::transmitter, this);
+}
+
+void tranceiver::watch_fd(reactor *const r, const int fd, const reactor_callback_t & cb)
+{
+	watch_r = r;
+	watch_fds.push_back(fd);
+
+	r->add(fd, cb);
+}
+
+void tranceiver::watch_fd(reactor *const r, const int fd, const reactor_callback_t & cb, const io_uring_callback_t & data_cb)
+{
+	watch_r = r;
+	watch_fds.push_back(fd);
+
+	r->add(fd, cb, data_cb);
+}
+
 void tranceiver::stop()
 {
 	terminate = true;
 
+	if (watch_r) {
+		for(int fd : watch_fds)
+			watch_r->remove(fd);
+
+		watch_r = nullptr;
+	}
+
 	if (th) {
 		th->join();
 
 		delete th;
 	}
 
+	if (tx_th) {
+		outgoing.wake();
+
+		tx_th->join();
+
+		delete tx_th;
+	}
+
 	if (s)
 		s->stop();
 }
 
 transmit_error_t tranceiver::queue_incoming_message(const message & m_in)
 {
-	message copy { m_in };
+	message *copy = new message(m_in);
 
-	auto content = copy.get_content();
+	auto content = copy->get_content();
 
 	stats_add_counter(ifInOctets,   content.second);
 	stats_add_counter(ifHCInOctets, content.second);
 	stats_inc_counter(ifInUcastPkts);
 
 	bool     ok   = true;
-	uint32_t hash = 0;
+	uint32_t hash = copy->get_digest();
 
 	// check if s was allocated because e.g. the beacon module does
 	// not allocate a seen object
-	if (s) {
-		auto ratelimit_rc = s->check(content.first, content.second);
-
-		ok   = ratelimit_rc.first;
-
-		hash = ratelimit_rc.second;
-	}
-	else {
-		hash = calc_crc32(content.first, content.second);
-	}
+	if (s)
+		ok = s->check(*copy);
 
-	std::map<std::string, db_record_data> meta;
+	packet_meta meta;
 
-	meta.insert({ "pkt-crc", db_record_gen(myformat("%08x", hash)) });
+	meta.set(mk_pkt_crc, db_record_gen(myformat("%08x", hash)));
 
-	copy.set_meta(meta);
+	copy->set_meta(meta);
 
 	if (ok == false) {
-		mlog(LL_DEBUG, copy, "queue_incoming_message", "dropped because of duplicates rate limiting");
+		mlog(LL_DEBUG, *copy, "queue_incoming_message", "dropped because of duplicates rate limiting");
+
+		delete copy;
 
 		return TE_ratelimiting;
 	}
 
-	// push to incoming queue of this tranceiver
-	{
-		auto meta2 = dissect_packet(content.first, content.second);
+	// the packet is dissected when a filter, route or sink first needs
+	// one of its fields, see message::get_meta()
 
-		if (meta2.has_value()) {
-			if (meta2.value().first.find("latitude") != meta2.value().first.end() && meta2.value().first.find("longitude") != meta2.value().first.end()) {
-				std::optional<position_t> position = gps->get_position();
+	mlog(LL_DEBUG, *copy, "queue_incoming_message", "queueing message");
 
-				if (position.has_value()) {
-					double cur_lat = meta2.value().first.find("latitude")->second.d_value;
-					double cur_lng = meta2.value().first.find("longitude")->second.d_value;
+	// from here on the dispatcher owns the message
+	if (shard->push(copy) == false) {
+		mlog(LL_WARNING, *copy, "queue_incoming_message", "dropped: dispatch queue is full");
 
-					double distance = calc_gps_distance(cur_lat, cur_lng, position.value().latitude, position.value().longitude);
+		stats_inc_counter(ifInDiscards);
 
-					meta2.value().first.insert({ "distance", myformat("%.2f", distance) });
-				}
-			}
+		delete copy;
 
-			copy.set_meta(meta2.value().first);
-
-			delete meta2.value().second;
-		}
-
-		std::unique_lock<std::mutex> lck(incoming_lock);
+		return TE_queue_full;
+	}
 
-		incoming.push(copy);
+	return TE_ok;
+}
 
-		incoming_cv.notify_all();
+transmit_error_t tranceiver::put_message(const message & m)
+{
+	message *copy = new message(m);
 
-		mlog(LL_DEBUG, copy, "queue_incoming_message", "message queued");
-	}
+	if (outgoing.push(copy) == false) {
+		mlog(LL_WARNING, m, "put_message", "dropped: transmit queue is full");
 
-	// let main know that there's work to process
-	{
-		std::unique_lock<std::mutex> lck(w->work_lock);
+		stats_inc_counter(ifOutDiscards);
 
-		w->work_list.push(this);
+		delete copy;
 
-		w->work_cv.notify_one();
+		return TE_queue_full;
 	}
 
 	return TE_ok;
 }
 
-bool tranceiver::peek()
+void tranceiver::transmitter()
 {
-	std::unique_lock<std::mutex> lck(incoming_lock);
+	set_thread_name("tx-" + get_id());
 
-	return incoming.empty() == false;
-}
+	while(!terminate) {
+		auto m = outgoing.pop(1000);
 
-std::optional<message> tranceiver::get_message()
-{
-	std::unique_lock<std::mutex> lck(incoming_lock);
+		if (m.has_value() == false)
+			continue;
 
-	while(incoming.empty()) {
-		if (incoming_cv.wait_for(lck, std::chrono::milliseconds(END_CHECK_INTERVAL_ms)) == std::cv_status::timeout)
-			return { };
-	}
+		size_t size = m.value()->get_content().second;
 
-	auto rc = incoming.front();
-	incoming.pop();
+		stats_add_counter(ifOutOctets,   size);
+		stats_add_counter(ifHCOutOctets, size);
+		stats_inc_counter(ifOutUcastPkts);
 
-	return rc;
-}
+		transmit_error_t rc = put_message_low(*m.value());
 
-transmit_error_t tranceiver::put_message(const message & m)
-{
-	size_t size = m.get_content().second;
+		// rate limiting and filtering are not errors of the link
+		if (rc == TE_hardware) {
+			mlog(LL_INFO, *m.value(), "transmitter", "transmit failed");
 
-	stats_add_counter(ifOutOctets,   size);
-	stats_add_counter(ifHCOutOctets, size);
-	stats_inc_counter(ifOutUcastPkts);
+			stats_inc_counter(ifOutErrors);
+		}
 
-	return put_message_low(m);
+		delete m.value();
+	}
 }
 
 tranceiver *tranceiver::instantiate(const libconfig::Setting & node, work_queue_t *const w, gps_connector *const gps, stats *const st, const size_t device_nr, ws_global_context_t *const ws, const std::vector<tranceiver *> & tranceivers, const std::map<std::string, filter_t> & filters, configuration *const cfg)
@@ -170,16 +200,16 @@ tranceiver *tranceiver::instantiate(const libconfig::Setting & node, work_queue_
 		t = tranceiver_aprs_si::instantiate(node, w, gps, st, device_nr);
 	}
 	else if (type == "kiss-kernel") {
-		t = tranceiver_kiss_kernel::instantiate(node, w, gps);
+		t = tranceiver_kiss_kernel::instantiate(node, w, gps, cfg->get_reactor());
 	}
 	else if (type == "kiss-tty") {
-		t = tranceiver_kiss_tty::instantiate(node, w, gps);
+		t = tranceiver_kiss_tty::instantiate(node, w, gps, cfg->get_reactor());
 	}
 	else if (type == "lora-sx1278") {
 		t = tranceiver_lora_sx1278::instantiate(node, w, gps, st, device_nr);
 	}
 	else if (type == "axudp") {
-		t = tranceiver_axudp::instantiate(node, w, gps, filters);
+		t = tranceiver_axudp::instantiate(node, w, gps, cfg->get_reactor(), filters, st, device_nr);
 	}
 	else if (type == "beacon") {
 		t = tranceiver_beacon::instantiate(node, w, gps);
@@ -205,32 +235,33 @@ void tranceiver::register_snmp_counters(stats *const st, const size_t device_nr)
         ifInOctets     = st->register_stat(myformat("%s-ifInOctets",     get_id().c_str()), myformat("1.3.6.1.2.1.2.2.1.10.%zu",    device_nr), snmp_integer::si_counter32);
         ifHCInOctets   = st->register_stat(myformat("%s-ifHCInOctets",   get_id().c_str()), myformat("1.3.6.1.2.1.31.1.1.1.6.%zu",  device_nr), snmp_integer::si_counter64);
         ifInUcastPkts  = st->register_stat(myformat("%s-ifInUcastPkts",  get_id().c_str()), myformat("1.3.6.1.2.1.2.2.1.11.%zu",    device_nr), snmp_integer::si_counter32);
+        ifInDiscards   = st->register_stat(myformat("%s-ifInDiscards",   get_id().c_str()), myformat("1.3.6.1.2.1.2.2.1.13.%zu",    device_nr), snmp_integer::si_counter32);
 
         ifOutOctets    = st->register_stat(myformat("%s-ifOutOctets",    get_id().c_str()), myformat("1.3.6.1.2.1.2.2.1.16.%zu",    device_nr), snmp_integer::si_counter32);
         ifHCOutOctets  = st->register_stat(myformat("%s-ifHCOutOctets",  get_id().c_str()), myformat("1.3.6.1.2.1.31.1.1.1.10.%zu", device_nr), snmp_integer::si_counter64);
         ifOutUcastPkts = st->register_stat(myformat("%s-ifOutUcastPkts", get_id().c_str()), myformat("1.3.6.1.2.1.2.2.1.17.%zu",    device_nr), snmp_integer::si_counter32);
+        ifOutDiscards  = st->register_stat(myformat("%s-ifOutDiscards",  get_id().c_str()), myformat("1.3.6.1.2.1.2.2.1.19.%zu",    device_nr), snmp_integer::si_counter32);
+        ifOutErrors    = st->register_stat(myformat("%s-ifOutErrors",    get_id().c_str()), myformat("1.3.6.1.2.1.2.2.1.20.%zu",    device_nr), snmp_integer::si_counter32);
 
 	if (s)
 		s->register_snmp_counters(st, get_id(), device_nr);
 }
 
-void tranceiver::log(const int llevel, const std::string & str)
+void tranceiver::log(const int llevel, const std::string & str) const
 {
 	::log(llevel, "%s", (get_type_name() + "(" + get_id() + "): " + str).c_str());
 }
 
-void tranceiver::mlog(const int llevel, const message & m, const std::string & where, const std::string & str)
+void tranceiver::mlog(const int llevel, const message & m, const std::string & where, const std::string & str) const
 {
-	auto meta = m.get_meta();
-
-	auto it   = meta.find("pkt-crc");
+	auto pkt_crc = m.get_meta_undissected().find(mk_pkt_crc);
 
-	auto crc  = it != meta.end() ? it->second.s_value : std::string("-");
+	auto crc     = pkt_crc ? pkt_crc->s_value : std::string("-");
 
 	::log(llevel, "%s", (get_type_name() + "(" + get_id() + "|" + where + ")[" + m.get_id_short() + "|" + crc + "]: " + str).c_str());
 }
 
-void tranceiver::llog(const int llevel, const libconfig::Setting & node, const std::string & str)
+void tranceiver::llog(const int llevel, const libconfig::Setting & node, const std::string & str) const
 {
 	::log(llevel, "%s", (get_type_name() + "(" + get_id() + ")@" + myformat("%u", node.getSourceLine()) + ": " + str).c_str());
 }
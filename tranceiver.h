@@ -14,13 +14,14 @@
 #include "filter.h"
 #include "gps.h"
 #include "message.h"
+#include "reactor.h"
 #include "seen.h"
 #include "stats.h"
 #include "websockets.h"
 #include "work.h"
 
 
-typedef enum { TE_ok, TE_hardware, TE_ratelimiting, TE_filter } transmit_error_t;
+typedef enum { TE_ok, TE_hardware, TE_ratelimiting, TE_filter, TE_queue_full } transmit_error_t;
 
 class tranceiver
 {
@@ -31,48 +32,65 @@ private:
         uint64_t          *ifInOctets     { &snmp_dummy };
         uint64_t          *ifHCInOctets   { &snmp_dummy };
         uint64_t          *ifInUcastPkts  { &snmp_dummy };
+        uint64_t          *ifInDiscards   { &snmp_dummy };
         uint64_t          *ifOutOctets    { &snmp_dummy };
         uint64_t          *ifHCOutOctets  { &snmp_dummy };
         uint64_t          *ifOutUcastPkts { &snmp_dummy };
+        uint64_t          *ifOutDiscards  { &snmp_dummy };
+        uint64_t          *ifOutErrors    { &snmp_dummy };
+
+	// messages waiting to be transmitted by tx_th
+	mpsc_queue<message *> outgoing;
+
+	std::thread      *tx_th      { nullptr };
+
+	void transmitter();
 
 protected:
 	work_queue_t      *const w   { nullptr };
+	work_shard_t      *const shard { nullptr };
 
 	seen              *const s   { nullptr };
 
 	gps_connector     *const gps { nullptr };
 
-	std::condition_variable incoming_cv;
-	std::mutex              incoming_lock;
-	std::queue<message>     incoming;
-
 	std::thread      *th         { nullptr };
 
+	// instead of a thread: the reactor invokes a callback
+	reactor          *watch_r    { nullptr };
+	std::vector<int>  watch_fds;
+
 	std::atomic_bool  terminate  { false   };
 
+	// can be invoked for more than one file descriptor
+	void watch_fd(reactor *const r, const int fd, const reactor_callback_t & cb);
+	// "data_cb" is used instead of "cb" when the reactor uses io_uring
+	void watch_fd(reactor *const r, const int fd, const reactor_callback_t & cb, const io_uring_callback_t & data_cb);
+
 	virtual transmit_error_t put_message_low(const message & m) = 0;
 
 public:
 	tranceiver(const std::string & id, seen *const s, work_queue_t *const w, gps_connector *const gps);
 	virtual ~tranceiver();
 
+	void start_transmitter();
+
 	void stop();
 
 	std::string get_id() const { return id; }
+
+	gps_connector * get_gps() const { return gps; }
 	virtual std::string get_type_name() const = 0;
 
 	void register_snmp_counters(stats *const s, const size_t device_nr);
 
 	transmit_error_t queue_incoming_message(const message & m);
 
-	bool peek();
-
-	void log(const int llevel, const std::string & str);
-	void llog(const int llevel, const libconfig::Setting & node, const std::string & str);
-	void mlog(const int llevel, const message & m, const std::string & where, const std::string & str);
-
-	std::optional<message> get_message();
+	void log(const int llevel, const std::string & str) const;
+	void llog(const int llevel, const libconfig::Setting & node, const std::string & str) const;
+	void mlog(const int llevel, const message & m, const std::string & where, const std::string & str) const;
 
+	// queues the message for transmission (by a separate thread)
 	transmit_error_t       put_message(const message & m);
 
 	static tranceiver *instantiate(const libconfig::Setting & node, work_queue_t *const w, gps_connector *const gps, stats *const st, const size_t device_nr, ws_global_context_t *const ws, const std::vector<tranceiver *> & tranceivers, const std::map<std::string, filter_t> & filters, configuration *const cfg);
@@ -251,16 +251,16 @@ MHD_Result process_http_request(void *cls,
 			page += "<tr><th></th><th>latitude</th><th>longitude</th><th>air time</th><th>rssi</th><th>protocol</th><th</tr>\n";
 
 			for(auto & record : history) {
-				auto        meta  = record.get_meta();
+				auto      & meta  = record.get_meta();
 
-				auto        from_it  = meta.find("from"    );
-				std::string from  = from_it != meta.end() ? from_it ->second.s_value : "";
+				auto        from_v   = meta.find(mk_from    );
+				std::string from  = from_v   ? from_v  ->s_value : "";
 
-				auto        to_it    = meta.find("to"      );
-				std::string to    = to_it   != meta.end() ? to_it   ->second.s_value : "";
+				auto        to_v     = meta.find(mk_to      );
+				std::string to    = to_v     ? to_v    ->s_value : "";
 
-				auto        proto_it = meta.find("protocol");
-				std::string proto = proto_it!= meta.end() ? proto_it->second.s_value : "";
+				auto        proto_v  = meta.find(mk_protocol);
+				std::string proto = proto_v  ? proto_v ->s_value : "";
 
 				time_t      t     = record.get_tv().tv_sec;
 				tm        * tm    = localtime(&t);
@@ -271,17 +271,22 @@ MHD_Result process_http_request(void *cls,
 				strftime(ts_buffer_date, sizeof(ts_buffer_date), "%Y-%m-%d", tm);
 				strftime(ts_buffer_time, sizeof(ts_buffer_time), "%H:%M:%S", tm);
 
-				auto        payload_it = record.get_meta().find("payload");
+				auto        payload_v  = meta.find(mk_payload);
 
-				std::string payload    = payload_it != record.get_meta().end() ? payload_it->second.s_value : "";
+				std::string payload    = payload_v ? payload_v->s_value : "";
 
-				std::string latitude   = myformat("%.8f", meta.find("latitude")  != meta.end() ? meta.at("latitude" ).d_value : 0.);
+				auto        latitude_v  = meta.find(mk_latitude );
+				auto        longitude_v = meta.find(mk_longitude);
+				auto        rssi_v      = meta.find(mk_rssi     );
+				auto        air_time_v  = meta.find(mk_air_time );
 
-				std::string longitude  = myformat("%.8f", meta.find("longitude") != meta.end() ? meta.at("longitude").d_value : 0.);
+				std::string latitude   = myformat("%.8f", latitude_v  ? latitude_v ->d_value : 0.);
 
-				std::string rssi       = meta.find("rssi") != meta.end() ? meta.at("rssi").s_value : "";
+				std::string longitude  = myformat("%.8f", longitude_v ? longitude_v->d_value : 0.);
 
-				std::string air_time   = myformat("%.2f", meta.find("air-time")  != meta.end() ? meta.at("air-time" ).d_value : 0.);
+				std::string rssi       = rssi_v ? rssi_v->s_value : "";
+
+				std::string air_time   = myformat("%.2f", air_time_v  ? air_time_v ->d_value : 0.);
 
 				const tranceiver *tx   = record.get_source();
 
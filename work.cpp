@@ -0,0 +1,40 @@
+#include <assert.h>
+
+#include "message.h"
+#include "work.h"
+
+
+void work_queue_init(work_queue_t *const w, const size_t n_shards, const size_t shard_size)
+{
+	assert(w->shards.empty());
+	assert(n_shards > 0);
+
+	for(size_t i=0; i<n_shards; i++)
+		w->shards.push_back(new work_shard_t(shard_size));
+}
+
+void work_queue_free(work_queue_t *const w)
+{
+	for(auto shard : w->shards) {
+		// messages that were not processed before termination
+		for(;;) {
+			auto m = shard->try_pop();
+
+			if (m.has_value() == false)
+				break;
+
+			delete m.value();
+		}
+
+		delete shard;
+	}
+
+	w->shards.clear();
+}
+
+work_shard_t * work_queue_assign(work_queue_t *const w)
+{
+	assert(w->shards.empty() == false);
+
+	return w->shards.at(w->next_shard++ % w->shards.size());
+}
@@ -1,12 +1,26 @@
-#include <condition_variable>
-#include <mutex>
-#include <queue>
+#pragma once
 
+#include <atomic>
+#include <vector>
 
-class tranceiver;
+#include "mpsc-queue.h"
+
+
+class message;
+
+// messages travel directly from the receiving thread to a dispatch worker
+typedef mpsc_queue<message *> work_shard_t;
 
 typedef struct {
-	std::condition_variable  work_cv;
-	std::mutex               work_lock;
-	std::queue<tranceiver *> work_list;
+	// one shard per dispatch worker
+	std::vector<work_shard_t *> shards;
+
+	std::atomic_size_t          next_shard { 0 };
 } work_queue_t;
+
+void           work_queue_init  (work_queue_t *const w, const size_t n_shards, const size_t shard_size);
+void           work_queue_free  (work_queue_t *const w);
+
+// a tranceiver always uses the same shard so that its messages
+// are processed in the order in which they were received
+work_shard_t * work_queue_assign(work_queue_t *const w);